@@ -0,0 +1,209 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <utility>
+#include "harness.hpp"
+
+namespace {
+
+// Names and notes are written by the benchmarks themselves, quotes and
+// backslashes are all they could need escaped.
+auto quoted(const std::string& text) -> std::string
+{
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result + "\"";
+}
+
+// A time with the unit that keeps it readable.
+auto readable(double seconds) -> std::string
+{
+    char text[32];
+    if (seconds >= 1) {
+        std::snprintf(text, sizeof(text), "%.3f s", seconds);
+    } else if (seconds >= 1e-3) {
+        std::snprintf(text, sizeof(text), "%.3f ms", seconds * 1e3);
+    } else {
+        std::snprintf(text, sizeof(text), "%.3f us", seconds * 1e6);
+    }
+    return text;
+}
+
+} // namespace
+
+namespace monoa::bench {
+
+stopwatch::stopwatch() : start(std::chrono::steady_clock::now())
+{
+}
+
+auto stopwatch::restart() -> void
+{
+    this->running = true;
+    this->start = std::chrono::steady_clock::now();
+}
+
+auto stopwatch::stop() -> void
+{
+    if (this->running) {
+        this->end = std::chrono::steady_clock::now();
+        this->running = false;
+    }
+}
+
+auto stopwatch::seconds() const -> double
+{
+    auto end = this->running ? std::chrono::steady_clock::now() : this->end;
+    return std::chrono::duration<double>(end - this->start).count();
+}
+
+auto summarize(std::vector<double> samples) -> statistics
+{
+    statistics result;
+    if (samples.empty()) {
+        return result;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&samples](double percentile) {
+        auto index = static_cast<std::size_t>(std::ceil(percentile * static_cast<double>(samples.size())));
+        return samples[std::min(samples.size(), std::max<std::size_t>(index, 1)) - 1];
+    };
+    result.min = samples.front();
+    result.median = rank(0.5);
+    result.p90 = rank(0.9);
+    result.p99 = rank(0.99);
+    result.max = samples.back();
+    result.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+    return result;
+}
+
+harness::harness(settings settings) : options(std::move(settings))
+{
+    if (!this->options.json) {
+        std::printf("%-30s %12s %12s %12s %18s\n", "benchmark", "median", "p90", "min", "throughput");
+    }
+}
+
+auto harness::enabled(const std::string& name) const -> bool
+{
+    return this->options.filter.empty() || name.find(this->options.filter) != std::string::npos;
+}
+
+auto harness::measure(const std::string& name,
+                      std::uint64_t items,
+                      const char* unit,
+                      const std::function<bool(stopwatch&)>& body,
+                      unsigned int scale) -> bool
+{
+    if (!this->enabled(name)) {
+        return true;
+    }
+    std::vector<double> samples;
+    auto runs = (this->options.warmup + this->options.repetitions) * scale;
+    for (unsigned int i = 0; i < runs; i++) {
+        stopwatch watch;
+        if (!body(watch)) {
+            return false;
+        }
+        watch.stop();
+        if (i >= this->options.warmup * scale) {
+            samples.push_back(watch.seconds());
+        }
+    }
+    auto& measured = this->measured.emplace_back(result{name, items, unit, samples.size(), summarize(samples)});
+    if (!this->options.json) {
+        double rate = measured.seconds.median > 0 ? static_cast<double>(items) / measured.seconds.median : 0;
+        char throughput[48];
+        if (rate >= 1e6) {
+            std::snprintf(throughput, sizeof(throughput), "%.2f M%s/s", rate / 1e6, unit);
+        } else {
+            std::snprintf(throughput, sizeof(throughput), "%.0f %s/s", rate, unit);
+        }
+        std::printf("%-30s %12s %12s %12s %18s\n",
+                    name.c_str(),
+                    readable(measured.seconds.median).c_str(),
+                    readable(measured.seconds.p90).c_str(),
+                    readable(measured.seconds.min).c_str(),
+                    throughput);
+        std::fflush(stdout);
+    }
+    return true;
+}
+
+auto harness::note(const std::string& name, const std::string& text) -> void
+{
+    if (!this->enabled(name)) {
+        return;
+    }
+    this->notes.emplace_back(name, text);
+    if (!this->options.json) {
+        std::printf("%-30s %s\n", name.c_str(), text.c_str());
+        std::fflush(stdout);
+    }
+}
+
+auto harness::finish() -> void
+{
+    if (!this->options.json) {
+        return;
+    }
+    std::printf("{\"warmup\": %u, \"repetitions\": %u, \"benchmarks\": [",
+                this->options.warmup,
+                this->options.repetitions);
+    for (std::size_t i = 0; i < this->measured.size(); i++) {
+        const auto& result = this->measured[i];
+        const auto& seconds = result.seconds;
+        std::printf("%s\n  {\"name\": %s, \"samples\": %zu, \"items\": %llu, \"unit\": %s, \"min\": %.9f, "
+                    "\"median\": %.9f, \"p90\": %.9f, \"p99\": %.9f, \"max\": %.9f, \"mean\": %.9f}",
+                    i == 0 ? "" : ",",
+                    quoted(result.name).c_str(),
+                    result.samples,
+                    static_cast<unsigned long long>(result.items),
+                    quoted(result.unit).c_str(),
+                    seconds.min,
+                    seconds.median,
+                    seconds.p90,
+                    seconds.p99,
+                    seconds.max,
+                    seconds.mean);
+    }
+    std::printf("\n], \"notes\": [");
+    for (std::size_t i = 0; i < this->notes.size(); i++) {
+        std::printf("%s\n  {\"name\": %s, \"text\": %s}",
+                    i == 0 ? "" : ",",
+                    quoted(this->notes[i].first).c_str(),
+                    quoted(this->notes[i].second).c_str());
+    }
+    std::printf("\n]}\n");
+}
+
+auto harness::results() const -> const std::vector<result>&
+{
+    return this->measured;
+}
+
+} // namespace monoa::bench
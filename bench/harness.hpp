@@ -0,0 +1,111 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_BENCH_HARNESS_HPP
+#define MONOA_BENCH_HARNESS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace monoa::bench {
+
+struct settings
+{
+    // Runs before measuring, to warm caches and the allocator.
+    unsigned int warmup = 2;
+    unsigned int repetitions = 10;
+    // Only benchmarks whose name contains it run, all of them when empty.
+    std::string filter;
+    bool json = false;
+};
+
+// Distribution of the samples of one benchmark, in seconds.
+struct statistics
+{
+    double min = 0;
+    double median = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double max = 0;
+    double mean = 0;
+};
+
+struct result
+{
+    std::string name;
+    // Work done by one run, throughput is measured at the median.
+    std::uint64_t items;
+    const char* unit;
+    std::size_t samples;
+    statistics seconds;
+};
+
+// Times one run of a benchmark. It starts with the run, a run restarts it
+// once it has set up what should not be measured, and stops it before
+// checking its results.
+class stopwatch
+{
+public:
+    stopwatch();
+    auto restart() -> void;
+    auto stop() -> void;
+    auto seconds() const -> double;
+
+private:
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+    bool running = true;
+};
+
+// Nearest rank percentiles of the samples.
+auto summarize(std::vector<double> samples) -> statistics;
+
+// Runs benchmarks and collects their statistics. As text each result is
+// printed once measured, as JSON the whole report is printed by finish, one
+// benchmark per line so that reports of two commits diff line by line.
+class harness
+{
+public:
+    harness(settings settings);
+    auto enabled(const std::string& name) const -> bool;
+    // Runs `body` through warmup and repetitions, `scale` times as many for
+    // benchmarks short enough to need more samples. A body returning false
+    // has failed and printed why, measuring stops there.
+    auto measure(const std::string& name,
+                 std::uint64_t items,
+                 const char* unit,
+                 const std::function<bool(stopwatch&)>& body,
+                 unsigned int scale = 1) -> bool;
+    // Something measured once rather than timed, such as a size.
+    auto note(const std::string& name, const std::string& text) -> void;
+    auto finish() -> void;
+    auto results() const -> const std::vector<result>&;
+
+private:
+    settings options;
+    std::vector<result> measured;
+    std::vector<std::pair<std::string, std::string>> notes;
+};
+
+} // namespace monoa::bench
+
+#endif // MONOA_BENCH_HARNESS_HPP
@@ -0,0 +1,738 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <sys/wait.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <ast/bytecode_compiler.hpp>
+#include <ast/compiler.hpp>
+#include <ast/flat.hpp>
+#include <backend/elf.hpp>
+#include <backend/encoder.hpp>
+#include <backend/jit.hpp>
+#include <io/file.hpp>
+#include <parser/lexer.hpp>
+#include <parser/parser.hpp>
+#include <parser/scanner.hpp>
+#include <support/thread_pool.hpp>
+#include <vm/interpreter.hpp>
+#include <vm/tiered.hpp>
+#include "harness.hpp"
+
+using namespace monoa;
+
+namespace {
+
+// A source of one input size, benchmarks name their results after it.
+struct input
+{
+    const char* size;
+    std::string source;
+};
+
+auto make_source(int function_count) -> std::string
+{
+    std::string source;
+    for (int i = 0; i < function_count; i++) {
+        source += "fun function_number_" + std::to_string(i) + "() -> i64\n{\n";
+        source += "    let variable_" + std::to_string(i) + " = 10;\n";
+        source += "    return 74 - 10 + 44 * 99 - 346 / 2 + " + std::to_string(i) + ";\n}\n\n";
+    }
+    source += "fun main() -> i64\n{\n    return 0;\n}\n";
+    return source;
+}
+
+// Evaluates a function by walking its tree on every call, with the typing of
+// the compiler: the baseline the bytecode interpreter is measured against.
+class tree_walker : public ast::visitor
+{
+public:
+    tree_walker(ast::root* ast) : symbols(ast->symbols)
+    {
+        ast->accept(this);
+    }
+
+    auto call(std::string_view name) -> std::optional<std::int64_t>
+    {
+        for (auto* function : this->functions) {
+            if (this->symbols->name(function->name) == name) {
+                this->returned = false;
+                this->result = value{};
+                function->statement_list->accept(this);
+                return static_cast<std::int64_t>(this->result.bits);
+            }
+        }
+        return std::nullopt;
+    }
+
+    auto visit(ast::root* node) -> void override
+    {
+        node->statement_list->accept(this);
+    }
+
+    auto visit(ast::literal* node) -> void override
+    {
+        this->result = value{std::visit([](auto bits) { return static_cast<std::uint64_t>(bits); }, node->value),
+                             node->type.type,
+                             true};
+    }
+
+    auto visit(ast::variable_reference* node) -> void override
+    {
+        for (auto it = this->locals.rbegin(); it != this->locals.rend(); it++) {
+            if (it->first == node->name) {
+                this->result = it->second;
+                return;
+            }
+        }
+    }
+
+    auto visit(ast::unary_operation* node) -> void override
+    {
+        node->right->accept(this);
+        auto right = this->result;
+        this->apply(ast::operation::subtraction, value{0, right.type, true}, right);
+    }
+
+    auto visit(ast::binary_operation* node) -> void override
+    {
+        node->left->accept(this);
+        auto left = this->result;
+        node->right->accept(this);
+        this->apply(node->op, left, this->result);
+    }
+
+    auto visit(ast::compound_statement* node) -> void override
+    {
+        auto scope = this->locals.size();
+        for (auto* statement : node->statements) {
+            statement->accept(this);
+            if (this->returned) {
+                break;
+            }
+        }
+        this->locals.resize(scope);
+    }
+
+    auto visit(ast::variable_declaration* node) -> void override
+    {
+        node->expr->accept(this);
+        this->locals.emplace_back(node->name, this->result);
+    }
+
+    auto visit(ast::function_declaration* node) -> void override
+    {
+        this->functions.push_back(node);
+    }
+
+    auto visit(ast::function_parameter*) -> void override
+    {
+    }
+
+    auto visit(ast::return_statement* node) -> void override
+    {
+        node->return_value->accept(this);
+        this->returned = true;
+    }
+
+private:
+    struct value
+    {
+        std::uint64_t bits = 0;
+        ast::basic_type type = ast::basic_type::i64;
+        bool constant = false;
+    };
+
+    const support::interner* symbols;
+    std::vector<ast::function_declaration*> functions;
+    std::vector<std::pair<support::symbol, value>> locals;
+    value result;
+    bool returned = false;
+
+    static auto extend(std::uint64_t bits, ast::basic_type type) -> std::uint64_t
+    {
+        switch (type) {
+        case ast::basic_type::u8:
+            return static_cast<std::uint8_t>(bits);
+        case ast::basic_type::i8:
+            return static_cast<std::uint64_t>(static_cast<std::int8_t>(bits));
+        case ast::basic_type::u16:
+            return static_cast<std::uint16_t>(bits);
+        case ast::basic_type::i16:
+            return static_cast<std::uint64_t>(static_cast<std::int16_t>(bits));
+        case ast::basic_type::u32:
+            return static_cast<std::uint32_t>(bits);
+        case ast::basic_type::i32:
+            return static_cast<std::uint64_t>(static_cast<std::int32_t>(bits));
+        default:
+            return bits;
+        }
+    }
+
+    auto apply(ast::operation op, value left, value right) -> void
+    {
+        auto type = ast::common_type(left.type, right.type);
+        auto a = left.constant ? left.bits : extend(left.bits, type);
+        auto b = right.constant ? right.bits : extend(right.bits, type);
+        std::uint64_t bits = 0;
+        switch (op) {
+        case ast::operation::addition:
+            bits = a + b;
+            break;
+        case ast::operation::subtraction:
+            bits = a - b;
+            break;
+        case ast::operation::multiplication:
+            bits = a * b;
+            break;
+        case ast::operation::division:
+            bits = ast::is_unsigned(type) ? a / b
+                                          : static_cast<std::uint64_t>(static_cast<std::int64_t>(a) /
+                                                                       static_cast<std::int64_t>(b));
+            break;
+        default:
+            break;
+        }
+        this->result = value{extend(bits, type), type, false};
+    }
+};
+
+auto same_tokens(const std::vector<parser::token>& a, const std::vector<parser::token>& b) -> bool
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); i++) {
+        if (a[i].type != b[i].type || a[i].offset != b[i].offset || a[i].length != b[i].length ||
+            a[i].value != b[i].value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto bench_lexer(bench::harness& harness, const input& input) -> bool
+{
+    std::vector<parser::token> reference;
+
+    for (auto set : {parser::scanner::isa::scalar, parser::scanner::isa::sse2, parser::scanner::isa::avx2}) {
+        auto name = std::string("lexer/") + parser::scanner::isa_name(set) + "/" + input.size;
+        if (parser::scanner::select(set) != set) {
+            harness.note(name, "unsupported");
+            continue;
+        }
+
+        std::vector<parser::token> tokens;
+        bool ok = harness.measure(name, input.source.size(), "bytes", [&input, &tokens](bench::stopwatch&) {
+            parser::lexer lexer(input.source);
+            tokens = lexer.take_tokens();
+            return true;
+        });
+        if (!ok || !harness.enabled(name)) {
+            continue;
+        }
+        if (reference.empty()) {
+            reference = tokens;
+        } else if (!same_tokens(reference, tokens)) {
+            std::fprintf(stderr, "%s : token mismatch with scalar\n", name.c_str());
+            parser::scanner::select(parser::scanner::detect());
+            return false;
+        }
+    }
+    parser::scanner::select(parser::scanner::detect());
+    return true;
+}
+
+// Building the tree and freeing it, the token vector copied outside of the
+// measure. Either policy frees the tree only with its arena, the heap policy
+// one allocation per request.
+auto bench_parser(bench::harness& harness, const input& input) -> bool
+{
+    parser::lexer lexer(input.source);
+    auto tokens = lexer.take_tokens();
+    const auto* symbols = lexer.symbols();
+
+    for (auto policy : {ast::arena::policy::heap, ast::arena::policy::block}) {
+        auto name = std::string("parser/") + (policy == ast::arena::policy::block ? "arena/" : "heap/") + input.size;
+        std::size_t reserved = 0;
+        bool ok = harness.measure(
+            name,
+            tokens.size(),
+            "tokens",
+            [&input, &tokens, symbols, &reserved, &name, policy](bench::stopwatch& watch) {
+                auto copy = tokens;
+                watch.restart();
+                parser::parser parser(std::move(copy), input.source, symbols, policy);
+                if (parser.error().has_value()) {
+                    std::fprintf(stderr, "%s : %s\n", name.c_str(), parser.error().value().c_str());
+                    return false;
+                }
+                reserved = parser.ast()->memory.bytes_reserved();
+                return true;
+            });
+        if (!ok) {
+            return false;
+        }
+        harness.note(name + "/reserved", std::to_string(reserved) + " bytes");
+    }
+    return true;
+}
+
+// One long expression mixing every precedence level, parsed alone.
+auto bench_expressions(bench::harness& harness) -> bool
+{
+    constexpr int terms = 200000;
+    std::string source = "fun main() -> i64\n{\n    let a = 3;\n    return a";
+    const char* operators[] = {" + ", " * ", " - ", " / "};
+    for (int i = 0; i < terms; i++) {
+        source += operators[i % 4];
+        source += i % 7 == 0 ? "-(a - " + std::to_string(i) + ")" : std::to_string(i % 1000 + 1);
+    }
+    source += ";\n}\n";
+
+    parser::lexer lexer(source);
+    auto tokens = lexer.take_tokens();
+    const auto* symbols = lexer.symbols();
+    return harness.measure(
+        "parser/expr", tokens.size(), "tokens", [&source, &tokens, symbols](bench::stopwatch& watch) {
+            auto copy = tokens;
+            watch.restart();
+            parser::parser parser(std::move(copy), source, symbols);
+            watch.stop();
+            if (parser.error().has_value()) {
+                std::fprintf(stderr, "parser/expr : %s\n", parser.error().value().c_str());
+                return false;
+            }
+            return true;
+        });
+}
+
+auto bench_codegen(bench::harness& harness, const input& input) -> bool
+{
+    parser::lexer lexer(input.source);
+    parser::parser parser(lexer.take_tokens(), input.source, lexer.symbols());
+    ast::flat_tree flat(parser.ast());
+    auto nodes = parser.ast()->memory.object_count();
+    auto suffix = std::string("/") + input.size;
+
+    // The same output from the tree and from its flattened form.
+    std::string reference;
+    bool ok = harness.measure("codegen/tree" + suffix, nodes, "nodes", [&parser, &reference](bench::stopwatch& watch) {
+        ast::compiler compiler(parser.ast());
+        watch.stop();
+        reference = compiler.result();
+        return true;
+    });
+    ok = ok && harness.measure("codegen/flat" + suffix, nodes, "nodes", [&flat, &reference](bench::stopwatch& watch) {
+        ast::compiler compiler(&flat);
+        watch.stop();
+        if (!reference.empty() && compiler.result() != reference) {
+            std::fprintf(stderr, "codegen : flat tree output differs\n");
+            return false;
+        }
+        return true;
+    });
+    if (!ok) {
+        return false;
+    }
+    harness.note("codegen/tree" + suffix + "/nodes", std::to_string(parser.ast()->memory.bytes_used()) + " bytes");
+    harness.note("codegen/flat" + suffix + "/nodes", std::to_string(flat.bytes_used()) + " bytes");
+
+    // Function bodies on one thread, then on every hardware thread.
+    std::vector<unsigned int> thread_counts = {1};
+    if (support::hardware_threads() > 1) {
+        thread_counts.push_back(support::hardware_threads());
+    }
+    for (unsigned int threads : thread_counts) {
+        auto name = "codegen/j" + std::to_string(threads) + suffix;
+        ok = harness.measure(name, nodes, "nodes", [&flat, &reference, threads](bench::stopwatch& watch) {
+            ast::compiler compiler(&flat, backend::options{true, threads});
+            watch.stop();
+            if (!reference.empty() && compiler.result() != reference) {
+                std::fprintf(stderr, "codegen : output differs with %u threads\n", threads);
+                return false;
+            }
+            return true;
+        });
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Source to runnable executable, either through the built in encoder or
+// through nasm and ld when they are installed.
+auto bench_build(bench::harness& harness, const input& input, bool external) -> bool
+{
+    const auto& source = input.source;
+    auto suffix = std::string("/") + input.size;
+    std::string assembly;
+    std::string executable;
+    bool ok = harness.measure("build/asm" + suffix, source.size(), "bytes", [&source, &assembly](bench::stopwatch&) {
+        parser::lexer lexer(source);
+        parser::parser parser(lexer.take_tokens(), source, lexer.symbols());
+        ast::compiler compiler(parser.ast());
+        assembly = compiler.result();
+        return true;
+    });
+    ok = ok && harness.measure("build/elf" + suffix, source.size(), "bytes", [&source, &executable](bench::stopwatch&) {
+        parser::lexer lexer(source);
+        parser::parser parser(lexer.take_tokens(), source, lexer.symbols());
+        ast::compiler compiler(parser.ast());
+        backend::encoder encoder(&compiler.program());
+        backend::elf_executable elf(encoder.text(), "", &encoder.symbols(), "_start");
+        if (encoder.error().has_value() || elf.error().has_value()) {
+            std::fprintf(stderr, "build : %s\n", encoder.error().value_or(elf.error().value_or("")).c_str());
+            return false;
+        }
+        executable = elf.result();
+        return true;
+    });
+    if (!ok) {
+        return false;
+    }
+    harness.note("build/asm" + suffix + "/size", std::to_string(assembly.size()) + " bytes");
+    harness.note("build/elf" + suffix + "/size", std::to_string(executable.size()) + " bytes");
+
+    auto name = "build/nasm" + suffix;
+    if (!external || !harness.enabled(name) || assembly.empty()) {
+        return true;
+    }
+    if (std::system("command -v nasm >/dev/null 2>&1 && command -v ld >/dev/null 2>&1") != 0) {
+        harness.note(name, "unavailable");
+        return true;
+    }
+    auto directory = std::filesystem::temp_directory_path();
+    auto path = (directory / "monoa_bench").string();
+    if (auto error = io::write_file(path + ".asm", assembly)) {
+        std::fprintf(stderr, "build : %s\n", error.value().c_str());
+        return false;
+    }
+    // On top of build/asm, the text is already written.
+    std::string command = "nasm -f elf64 " + path + ".asm -o " + path + ".o && ld " + path + ".o -o " + path;
+    ok = harness.measure(name, source.size(), "bytes", [&command](bench::stopwatch&) {
+        if (std::system(command.c_str()) != 0) {
+            std::fprintf(stderr, "build/nasm : failed\n");
+            return false;
+        }
+        return true;
+    });
+    for (const char* extension : {".asm", ".o", ""}) {
+        std::filesystem::remove(path + extension);
+    }
+    return ok;
+}
+
+// Source of a small program to its result, once in process and once through
+// an executable written to disk and started by the shell.
+auto bench_run(bench::harness& harness) -> bool
+{
+    const std::string source = "fun main() -> i64\n{\n    let a = 74 - 10;\n    return a + 44 * 99 - 346 / 2;\n}\n";
+    static constexpr std::int64_t expected = 74 - 10 + 44 * 99 - 346 / 2;
+
+    std::string executable;
+    bool ok = harness.measure(
+        "run/jit",
+        1,
+        "runs",
+        [&source, &executable](bench::stopwatch& watch) {
+            parser::lexer lexer(source);
+            parser::parser parser(lexer.take_tokens(), source, lexer.symbols());
+            ast::compiler compiler(parser.ast());
+            backend::encoder encoder(&compiler.program());
+            backend::jit jit(encoder.text(), &encoder.symbols());
+            auto result = jit.call("main");
+            watch.stop();
+            if (result != expected) {
+                std::fprintf(stderr, "run/jit : wrong result\n");
+                return false;
+            }
+            executable = backend::elf_executable(encoder.text(), "", &encoder.symbols(), "_start").result();
+            return true;
+        },
+        10);
+    if (!ok || !harness.enabled("run/exec")) {
+        return ok;
+    }
+    if (executable.empty()) {
+        parser::lexer lexer(source);
+        parser::parser parser(lexer.take_tokens(), source, lexer.symbols());
+        ast::compiler compiler(parser.ast());
+        backend::encoder encoder(&compiler.program());
+        executable = backend::elf_executable(encoder.text(), "", &encoder.symbols(), "_start").result();
+    }
+
+    auto path = (std::filesystem::temp_directory_path() / "monoa_bench_run").string();
+    if (auto error = io::write_file(path, executable, 0755)) {
+        std::fprintf(stderr, "run : %s\n", error.value().c_str());
+        return false;
+    }
+    // Starting the executable alone.
+    ok = harness.measure("run/exec", 1, "runs", [&path](bench::stopwatch&) {
+        int status = std::system(path.c_str());
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != (expected & 0xff)) {
+            std::fprintf(stderr, "run/exec : wrong result\n");
+            return false;
+        }
+        return true;
+    });
+    std::filesystem::remove(path);
+    return ok;
+}
+
+// Calls of one long function once its code is ready, walking the tree, on the
+// bytecode interpreter and natively.
+auto bench_vm(bench::harness& harness) -> bool
+{
+    constexpr int statements = 2000;
+    std::string source = "fun main() -> i64\n{\n    let v0 = 7;\n    let v1 = 11;\n";
+    for (int i = 2; i < statements; i++) {
+        source += "    let v" + std::to_string(i) + " = (v" + std::to_string(i - 1) + " * 3 + " + std::to_string(i) +
+                  ") / 2 - v" + std::to_string(i - 2) + ";\n";
+    }
+    source += "    return v" + std::to_string(statements - 1) + ";\n}\n";
+
+    parser::lexer lexer(source);
+    parser::parser parser(lexer.take_tokens(), source, lexer.symbols());
+    ast::compiler compiler(parser.ast());
+    ast::bytecode_compiler bytecode(parser.ast());
+    backend::encoder encoder(&compiler.program());
+    backend::jit jit(encoder.text(), &encoder.symbols());
+    vm::interpreter interpreter(&bytecode.result());
+    tree_walker walker(parser.ast());
+    if (compiler.error().has_value() || bytecode.error().has_value() || jit.error().has_value() ||
+        interpreter.error().has_value()) {
+        std::fprintf(stderr,
+                     "vm : %s\n",
+                     compiler.error().value_or(bytecode.error().value_or(jit.error().value_or(""))).c_str());
+        return false;
+    }
+
+    auto expected = jit.call("main");
+    std::pair<const char*, std::function<std::optional<std::int64_t>()>> engines[] = {
+        {"vm/tree", [&walker]() { return walker.call("main"); }},
+        {"vm/bytecode", [&interpreter]() { return interpreter.call("main"); }},
+        {"vm/native", [&jit]() { return jit.call("main"); }},
+    };
+    for (auto& [name, run] : engines) {
+        bool ok = harness.measure(
+            name,
+            1,
+            "calls",
+            [&run, &expected, name = name](bench::stopwatch& watch) {
+                auto result = run();
+                watch.stop();
+                if (result != expected) {
+                    std::fprintf(stderr, "%s : wrong result\n", name);
+                    return false;
+                }
+                return true;
+            },
+            10);
+        if (!ok) {
+            return false;
+        }
+    }
+    harness.note("vm/size",
+                 std::to_string(bytecode.result().functions.front().code.size() * sizeof(vm::instruction)) +
+                     " bytes of bytecode");
+    return true;
+}
+
+// Source to the results of a workload where most functions run once and a few
+// run many times: interpreting everything, compiling everything ahead of
+// time, and tiering up the hot functions.
+auto bench_tiers(bench::harness& harness) -> bool
+{
+    constexpr int functions = 2000;
+    constexpr int hot_functions = 10;
+    constexpr int hot_calls = 100000;
+    std::string source;
+    for (int i = 0; i < functions; i++) {
+        auto n = std::to_string(i);
+        source += "fun f" + n + "() -> i64\n{\n    let a = " + n + " * 3 + 1;\n    let b = (a - 7) * (a + " + n +
+                  ");\n    let c = b / 5 - a * 2;\n    return (c + b) * 3 - a / 2;\n}\n";
+    }
+    source += "fun main() -> i64\n{\n    return 0;\n}\n";
+    parser::lexer lexer(source);
+    parser::parser parser(lexer.take_tokens(), source, lexer.symbols());
+
+    // Every function once, then the first few many more times.
+    auto workload = [](auto& call) {
+        std::int64_t sum = 0;
+        for (int i = 0; i < functions; i++) {
+            sum += call(i);
+        }
+        for (int round = 0; round < hot_calls; round++) {
+            for (int i = 0; i < hot_functions; i++) {
+                sum += call(i);
+            }
+        }
+        return sum;
+    };
+
+    auto interpret = [&parser, &workload]() {
+        ast::bytecode_compiler compiler(parser.ast());
+        vm::interpreter interpreter(&compiler.result());
+        auto call = [&interpreter](int i) { return interpreter.call(static_cast<std::size_t>(i)).value_or(0); };
+        return workload(call);
+    };
+    auto ahead = [&parser, &workload]() {
+        ast::compiler compiler(parser.ast());
+        backend::encoder encoder(&compiler.program());
+        backend::jit jit(encoder.text(), &encoder.symbols());
+        std::vector<std::int64_t (*)()> entries;
+        for (int i = 0; i < functions; i++) {
+            auto* address = jit.address("f" + std::to_string(i));
+            entries.push_back(reinterpret_cast<std::int64_t (*)()>(const_cast<void*>(address)));
+        }
+        auto call = [&entries](int i) { return entries[static_cast<std::size_t>(i)](); };
+        return workload(call);
+    };
+    std::size_t promoted = 0;
+    auto tiered = [&parser, &workload, &promoted]() {
+        ast::bytecode_compiler compiler(parser.ast());
+        vm::tiered engine(&compiler.result());
+        auto call = [&engine](int i) { return engine.call(static_cast<std::size_t>(i)).value_or(0); };
+        auto sum = workload(call);
+        promoted = engine.tier_ups().size();
+        return sum;
+    };
+
+    std::pair<const char*, std::function<std::int64_t()>> strategies[] = {
+        {"tiers/interp", interpret},
+        {"tiers/ahead", ahead},
+        {"tiers/tiered", tiered},
+    };
+    std::int64_t expected = 0;
+    for (auto& [name, run] : strategies) {
+        bool ok = harness.measure(name, 1, "runs", [&run, &expected, name = name](bench::stopwatch& watch) {
+            auto result = run();
+            watch.stop();
+            expected = expected == 0 ? result : expected;
+            if (result != expected) {
+                std::fprintf(stderr, "%s : wrong result\n", name);
+                return false;
+            }
+            return true;
+        });
+        if (!ok) {
+            return false;
+        }
+    }
+    if (harness.enabled("tiers/tiered")) {
+        auto text = std::to_string(promoted) + " of " + std::to_string(functions) + " functions compiled";
+        harness.note("tiers/hot", text);
+    }
+    return true;
+}
+
+// Programs that the flattened tree must compile exactly like the tree,
+// errors included. They are checked before anything is measured.
+const char* const path_checks[] = {
+    // A variable of one function is not visible in the next.
+    "fun f() -> i64 { let a = 1; let b = a + a; return b; } fun main() -> i64 { return b * 2; }",
+    "fun f() -> i64 { let a = 1; return a; } fun main() -> i64 { let a = 2; return a * 3; }",
+};
+
+auto check_codegen_paths() -> bool
+{
+    for (std::string_view source : path_checks) {
+        parser::lexer lexer(source);
+        parser::parser parser(lexer.take_tokens(), source, lexer.symbols());
+        if (parser.error().has_value()) {
+            std::fprintf(stderr, "codegen check : %s\n", parser.error().value().c_str());
+            return false;
+        }
+        ast::flat_tree flat(parser.ast());
+        ast::compiler tree(parser.ast());
+        ast::compiler flattened(&flat);
+        if (tree.error() != flattened.error() || tree.result() != flattened.result()) {
+            std::fprintf(stderr, "codegen check : flat tree differs on '%s'\n", source.data());
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* usage = "usage: monoa_bench [--warmup <runs>] [--repetitions <runs>] [--filter <text>] [--json]\n";
+
+auto parse_count(const char* text, unsigned int& count) -> bool
+{
+    char* end = nullptr;
+    count = static_cast<unsigned int>(std::strtoul(text, &end, 10));
+    return end != text && *end == '\0';
+}
+
+} // namespace
+
+// Every phase on a small, a medium and a large input, then the benchmarks of
+// a single program.
+auto main(int argc, char* argv[]) -> int
+{
+    bench::settings settings;
+    for (int i = 1; i < argc; i++) {
+        std::string_view argument = argv[i];
+        bool ok = true;
+        if (argument == "--warmup" && i + 1 < argc) {
+            ok = parse_count(argv[++i], settings.warmup);
+        } else if (argument == "--repetitions" && i + 1 < argc) {
+            ok = parse_count(argv[++i], settings.repetitions) && settings.repetitions > 0;
+        } else if (argument == "--filter" && i + 1 < argc) {
+            settings.filter = argv[++i];
+        } else if (argument == "--json") {
+            settings.json = true;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "%s", usage);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const input inputs[] = {
+        {"small", make_source(100)},
+        {"medium", make_source(5000)},
+        {"large", make_source(50000)},
+    };
+    if (!check_codegen_paths()) {
+        return EXIT_FAILURE;
+    }
+    bench::harness harness(settings);
+    for (const auto& input : inputs) {
+        if (!bench_lexer(harness, input) || !bench_parser(harness, input) || !bench_codegen(harness, input) ||
+            !bench_build(harness, input, input.size == std::string_view("medium"))) {
+            return EXIT_FAILURE;
+        }
+    }
+    if (!bench_expressions(harness) || !bench_run(harness) || !bench_vm(harness) || !bench_tiers(harness)) {
+        return EXIT_FAILURE;
+    }
+    harness.finish();
+    return EXIT_SUCCESS;
+}
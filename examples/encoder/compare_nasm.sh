@@ -0,0 +1,81 @@
+#!/bin/sh
+#
+# This file is part of Monoa
+# Copyright (c) 2020 Nattakit Hosapsin
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Checks that the machine code of `monoa --elf` is byte for byte what nasm
+# assembles from the text output of the same input. Every input is built with
+# and without folding, and the .text sections are compared.
+#
+# usage: compare_nasm.sh <monoa> [<input.mna>...]
+#
+# Without inputs the corpus next to this script is used. Fails when nasm or
+# objcopy is not installed, nothing has been compared then.
+
+set -u
+
+if [ $# -lt 1 ]; then
+    echo "usage: compare_nasm.sh <monoa> [<input.mna>...]" >&2
+    exit 2
+fi
+monoa=$1
+shift
+
+if ! command -v nasm >/dev/null 2>&1; then
+    echo "nasm not found" >&2
+    exit 2
+fi
+if ! command -v objcopy >/dev/null 2>&1; then
+    echo "objcopy not found" >&2
+    exit 2
+fi
+
+if [ $# -eq 0 ]; then
+    set -- "$(dirname "$0")"/*.mna
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+compared=0
+failed=0
+for input in "$@"; do
+    name=$(basename "$input" .mna)
+    for fold in fold no-fold; do
+        flags=
+        if [ "$fold" = no-fold ]; then
+            flags=--no-fold
+        fi
+        base="$work/$name.$fold"
+        if ! "$monoa" $flags -o "$base.s" "$input" ||
+            ! nasm -f elf64 -o "$base.o" "$base.s" ||
+            ! objcopy -O binary --only-section=.text "$base.o" "$base.nasm.bin" ||
+            ! "$monoa" $flags --elf -o "$base.elf" "$input" ||
+            ! objcopy -O binary --only-section=.text "$base.elf" "$base.monoa.bin"; then
+            echo "$input ($fold) : build failed"
+            failed=$((failed + 1))
+            continue
+        fi
+        compared=$((compared + 1))
+        if ! cmp "$base.nasm.bin" "$base.monoa.bin"; then
+            echo "$input ($fold) : .text differs from nasm"
+            failed=$((failed + 1))
+        fi
+    done
+done
+
+echo "$compared compared, $failed failed"
+[ "$failed" -eq 0 ]
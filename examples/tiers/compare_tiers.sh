@@ -0,0 +1,71 @@
+#!/bin/sh
+#
+# This file is part of Monoa
+# Copyright (c) 2020 Nattakit Hosapsin
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Checks that running functions as native code is not observable: every
+# input runs on the interpreter, on the tiered engine with a threshold of
+# zero, which compiles every function on its first call, and compiled ahead
+# with --run, and the output, errors and exit status must be the same. Inputs
+# are run with and without folding.
+#
+# usage: compare_tiers.sh <monoa> [<input.mna>...]
+#
+# Without inputs the corpus next to this script is used.
+
+set -u
+
+if [ $# -lt 1 ]; then
+    echo "usage: compare_tiers.sh <monoa> [<input.mna>...]" >&2
+    exit 2
+fi
+monoa=$1
+shift
+
+if [ $# -eq 0 ]; then
+    set -- "$(dirname "$0")"/*.mna
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+compared=0
+failed=0
+for input in "$@"; do
+    for fold in fold no-fold; do
+        flags=
+        if [ "$fold" = no-fold ]; then
+            flags=--no-fold
+        fi
+        "$monoa" $flags --vm "$input" >"$work/vm" 2>&1
+        echo "exit $?" >>"$work/vm"
+        "$monoa" $flags --tiered --tier-threshold 0 "$input" >"$work/tiered" 2>&1
+        echo "exit $?" >>"$work/tiered"
+        "$monoa" $flags --run "$input" >"$work/run" 2>&1
+        echo "exit $?" >>"$work/run"
+        for engine in tiered run; do
+            compared=$((compared + 1))
+            if ! cmp -s "$work/vm" "$work/$engine"; then
+                echo "$input ($fold) : $engine differs from the interpreter"
+                diff "$work/vm" "$work/$engine"
+                failed=$((failed + 1))
+            fi
+        done
+    done
+done
+
+echo "$compared compared, $failed failed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,280 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "generator.hpp"
+
+namespace {
+
+// Every value written stays within this bound, so that no sum, product or
+// negation of two of them can leave an i64 however the folder evaluates it.
+constexpr __int128 value_bound = static_cast<__int128>(1) << 62;
+
+constexpr std::size_t chunk_size = 1 << 20;
+
+constexpr std::string_view main_function = "fun main() -> i64\n{\n    return 0;\n}\n";
+
+auto magnitude(__int128 value) -> __int128
+{
+    return value < 0 ? -value : value;
+}
+
+} // namespace
+
+namespace monoa::generator {
+
+generator::generator(settings settings, std::FILE* out) : options(settings), out(out), state(settings.seed)
+{
+    this->options.width = std::max<std::uint64_t>(this->options.width, 1);
+    this->options.literal_digits = std::clamp(this->options.literal_digits, 1u, 18u);
+    this->options.identifier_length = std::max(this->options.identifier_length, 3u);
+    this->buffer.reserve(chunk_size + 4096);
+
+    for (std::uint64_t i = 0; !this->error_string.has_value(); i++) {
+        if (!this->options.size.has_value()) {
+            if (i >= this->options.functions) {
+                break;
+            }
+            this->emit_function(i);
+            continue;
+        }
+        // A function that would take the output past the size, main
+        // included, is taken back and ends the program.
+        auto start = this->buffer.size();
+        this->emit_function(i);
+        if (this->written + this->buffer.size() + main_function.size() > this->options.size.value()) {
+            this->buffer.resize(start);
+            break;
+        }
+        if (this->buffer.size() >= chunk_size) {
+            this->flush();
+        }
+    }
+    this->emit(main_function);
+    this->flush();
+}
+
+auto generator::bytes() -> std::uint64_t
+{
+    return this->written;
+}
+
+auto generator::error() -> std::optional<std::string>
+{
+    return this->error_string;
+}
+
+// splitmix64, the same numbers on every platform for the same seed.
+auto generator::next() -> std::uint64_t
+{
+    this->state += 0x9e3779b97f4a7c15;
+    auto z = this->state;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+auto generator::below(std::uint64_t bound) -> std::uint64_t
+{
+    return this->next() % bound;
+}
+
+auto generator::chance(double probability) -> bool
+{
+    return static_cast<double>(this->next() >> 11) * 0x1.0p-53 < probability;
+}
+
+auto generator::emit(std::string_view text) -> void
+{
+    this->buffer.append(text);
+    if (this->buffer.size() >= chunk_size && !this->options.size.has_value()) {
+        this->flush();
+    }
+}
+
+auto generator::emit_number(std::uint64_t number) -> void
+{
+    this->emit(std::to_string(number));
+}
+
+// A prefix and the index in letters, padded to the identifier length.
+auto generator::emit_name(char prefix, std::uint64_t index) -> void
+{
+    char letters[32];
+    std::size_t length = 0;
+    do {
+        letters[length++] = static_cast<char>('a' + index % 26);
+        index /= 26;
+    } while (index > 0);
+    std::string name(1, prefix);
+    name += '_';
+    if (length + 2 < this->options.identifier_length) {
+        name.append(this->options.identifier_length - 2 - length, 'a');
+    }
+    name.append(std::make_reverse_iterator(letters + length), std::make_reverse_iterator(letters));
+    this->emit(name);
+}
+
+auto generator::emit_leaf(const leaf& leaf) -> void
+{
+    if (leaf.negated) {
+        this->emit("-");
+    }
+    if (leaf.literal) {
+        this->emit_number(leaf.data);
+    } else {
+        this->emit_name('v', leaf.data);
+    }
+}
+
+auto generator::emit_function(std::uint64_t index) -> void
+{
+    this->emit("fun ");
+    this->emit_name('f', index);
+    this->emit("() -> i64\n{\n");
+    for (std::uint64_t i = 0; i < this->options.statements; i++) {
+        this->emit("    let ");
+        this->emit_name('v', i);
+        this->emit(" = ");
+        this->variables.push_back(this->expression());
+        this->emit(";\n");
+    }
+    this->emit("    return ");
+    this->expression();
+    this->emit(";\n}\n\n");
+    this->variables.clear();
+}
+
+auto generator::make_leaf() -> leaf
+{
+    leaf result{};
+    result.literal = this->variables.empty() || this->chance(this->options.literal_ratio);
+    if (result.literal) {
+        result.data = this->make_literal();
+        result.value = static_cast<std::int64_t>(result.data);
+    } else {
+        result.data = this->below(this->variables.size());
+        result.value = this->variables[result.data];
+    }
+    result.negated = this->chance(0.1);
+    result.value = result.negated ? -result.value : result.value;
+    return result;
+}
+
+// Anything from one digit to the most allowed, short and long literals
+// equally likely.
+auto generator::make_literal() -> std::uint64_t
+{
+    auto digits = 1 + this->below(this->options.literal_digits);
+    std::uint64_t value = digits == 1 ? this->below(10) : 1 + this->below(9);
+    for (std::uint64_t i = 1; i < digits; i++) {
+        value = value * 10 + this->below(10);
+    }
+    return value;
+}
+
+// The outer levels are opened first, the innermost operand written, then
+// every level closed from the inside out, so that nesting needs no
+// recursion. The first operand of every level is the level inside it.
+auto generator::expression() -> std::int64_t
+{
+    for (std::uint64_t level = 0; level < this->options.depth; level++) {
+        bool negated = this->chance(0.2);
+        this->negated_levels.push_back(negated);
+        this->emit(negated ? "-(" : "(");
+    }
+    auto first = this->make_leaf();
+    this->emit_leaf(first);
+    auto value = this->level_tail(first.value);
+    while (!this->negated_levels.empty()) {
+        this->emit(")");
+        value = this->negated_levels.back() ? -value : value;
+        this->negated_levels.pop_back();
+        value = this->level_tail(value);
+    }
+    return value;
+}
+
+// The operands of a level after its first, with the precedence of the
+// parser: a product is a term of the sum until a '+' or '-' ends it. A
+// term that would take the sum out of bounds is divided down first.
+auto generator::level_tail(std::int64_t first) -> std::int64_t
+{
+    __int128 sum = 0;
+    __int128 term = first;
+    int sign = 1;
+    bool summed = false;
+    auto close_term = [&]() {
+        auto closed = summed ? sum + sign * term : term;
+        if (summed && magnitude(closed) > value_bound) {
+            auto divisor = static_cast<std::uint64_t>(magnitude(term) + 1);
+            this->emit(" / ");
+            this->emit_number(divisor);
+            term /= static_cast<__int128>(divisor);
+            closed = sum + sign * term;
+        }
+        sum = closed;
+        summed = true;
+    };
+
+    for (std::uint64_t i = 1; i < this->options.width; i++) {
+        auto operand = this->make_leaf();
+        auto op = this->below(4);
+        if (op == 2 && magnitude(term * operand.value) > value_bound) {
+            op = 3;
+        }
+        if (op == 3 && operand.value == 0) {
+            operand = leaf{static_cast<std::int64_t>(1 + this->below(9)), 0, true, false};
+            operand.data = static_cast<std::uint64_t>(operand.value);
+        }
+        switch (op) {
+        case 0:
+        case 1:
+            close_term();
+            sign = op == 0 ? 1 : -1;
+            term = operand.value;
+            this->emit(op == 0 ? " + " : " - ");
+            break;
+        case 2:
+            term *= operand.value;
+            this->emit(" * ");
+            break;
+        default:
+            term /= operand.value;
+            this->emit(" / ");
+            break;
+        }
+        this->emit_leaf(operand);
+    }
+    close_term();
+    return static_cast<std::int64_t>(sum);
+}
+
+auto generator::flush() -> void
+{
+    if (this->buffer.empty() || this->error_string.has_value()) {
+        return;
+    }
+    if (std::fwrite(this->buffer.data(), 1, this->buffer.size(), this->out) != this->buffer.size()) {
+        this->error_string = "writing failed";
+    }
+    this->written += this->buffer.size();
+    this->buffer.clear();
+}
+
+} // namespace monoa::generator
@@ -0,0 +1,106 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_GENERATOR_GENERATOR_HPP
+#define MONOA_GENERATOR_GENERATOR_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace monoa::generator {
+
+struct settings
+{
+    std::uint64_t seed = 1;
+    std::uint64_t functions = 100;
+    // Functions are written while the output stays within this many bytes
+    // instead, when set. main is always written, even when it alone does
+    // not fit.
+    std::optional<std::uint64_t> size;
+    // Let statements in every function, before its return.
+    std::uint64_t statements = 8;
+    // Parenthesized levels nested in every expression, and operands in each
+    // level.
+    std::uint64_t depth = 2;
+    std::uint64_t width = 4;
+    // Chance for an operand to be a literal rather than a variable, and the
+    // most digits a literal gets.
+    double literal_ratio = 0.5;
+    unsigned int literal_digits = 3;
+    // Length of function and variable names.
+    unsigned int identifier_length = 8;
+};
+
+// Writes a random monoa program that every stage accepts, the same one for
+// the same settings. The value of every expression is followed as it is
+// written, so that constant folding never overflows nor divides by zero.
+// Nesting is written without recursion, and the output goes out in chunks
+// as it is made, any depth and any size take the same little memory. With a
+// size, a function only goes out once it is known to fit, so the largest
+// function is held whole.
+class generator
+{
+public:
+    generator(settings settings, std::FILE* out);
+    auto bytes() -> std::uint64_t;
+    auto error() -> std::optional<std::string>;
+
+private:
+    // An operand without parentheses, a literal or a variable, negated or
+    // not. `data` is the number of a literal and the index of a variable.
+    struct leaf
+    {
+        std::int64_t value;
+        std::uint64_t data;
+        bool literal;
+        bool negated;
+    };
+
+    settings options;
+    std::FILE* out;
+    std::string buffer;
+    std::uint64_t written = 0;
+    std::optional<std::string> error_string;
+    std::uint64_t state;
+    // Values of the variables of the current function.
+    std::vector<std::int64_t> variables;
+    // Whether each open level is negated.
+    std::vector<bool> negated_levels;
+
+    auto next() -> std::uint64_t;
+    auto below(std::uint64_t bound) -> std::uint64_t;
+    auto chance(double probability) -> bool;
+    auto emit(std::string_view text) -> void;
+    auto emit_number(std::uint64_t number) -> void;
+    auto emit_name(char prefix, std::uint64_t index) -> void;
+    auto emit_leaf(const leaf& leaf) -> void;
+    auto emit_function(std::uint64_t index) -> void;
+    auto make_leaf() -> leaf;
+    auto make_literal() -> std::uint64_t;
+    auto expression() -> std::int64_t;
+    auto level_tail(std::int64_t first) -> std::int64_t;
+    auto flush() -> void;
+};
+
+} // namespace monoa::generator
+
+#endif // MONOA_GENERATOR_GENERATOR_HPP
@@ -0,0 +1,124 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "generator.hpp"
+
+using namespace monoa;
+
+namespace {
+
+const char* usage = "usage: monoa_generator [-o <output>] [--seed <n>] [--functions <n> | --size <bytes>[k|m|g]]\n"
+                    "                       [--statements <n>] [--depth <n>] [--width <n>] [--literal-ratio <0..1>]\n"
+                    "                       [--literal-digits <n>] [--identifier-length <n>]\n";
+
+auto parse_count(const char* text, std::uint64_t& count) -> bool
+{
+    char* end = nullptr;
+    count = std::strtoull(text, &end, 10);
+    return end != text && *end == '\0';
+}
+
+// A byte count with an optional binary suffix.
+auto parse_size(const char* text, std::uint64_t& size) -> bool
+{
+    char* end = nullptr;
+    size = std::strtoull(text, &end, 10);
+    if (end == text) {
+        return false;
+    }
+    std::string_view suffix = end;
+    if (suffix == "k" || suffix == "K") {
+        size <<= 10;
+    } else if (suffix == "m" || suffix == "M") {
+        size <<= 20;
+    } else if (suffix == "g" || suffix == "G") {
+        size <<= 30;
+    } else if (!suffix.empty()) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+auto main(int argc, char* argv[]) -> int
+{
+    generator::settings settings;
+    const char* output = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view argument = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        std::uint64_t number = 0;
+        bool ok = value != nullptr;
+        if (argument == "-o" && ok) {
+            output = value;
+        } else if (argument == "--seed" && ok) {
+            ok = parse_count(value, settings.seed);
+        } else if (argument == "--functions" && ok) {
+            ok = parse_count(value, settings.functions);
+        } else if (argument == "--size" && ok) {
+            ok = parse_size(value, number);
+            settings.size = number;
+        } else if (argument == "--statements" && ok) {
+            ok = parse_count(value, settings.statements);
+        } else if (argument == "--depth" && ok) {
+            ok = parse_count(value, settings.depth);
+        } else if (argument == "--width" && ok) {
+            ok = parse_count(value, settings.width) && settings.width > 0;
+        } else if (argument == "--literal-ratio" && ok) {
+            char* end = nullptr;
+            settings.literal_ratio = std::strtod(value, &end);
+            ok = end != value && *end == '\0' && settings.literal_ratio >= 0 && settings.literal_ratio <= 1;
+        } else if (argument == "--literal-digits" && ok) {
+            ok = parse_count(value, number) && number >= 1 && number <= 18;
+            settings.literal_digits = static_cast<unsigned int>(number);
+        } else if (argument == "--identifier-length" && ok) {
+            ok = parse_count(value, number) && number >= 3 && number <= 1024;
+            settings.identifier_length = static_cast<unsigned int>(number);
+        } else if (argument == "-h" || argument == "--help") {
+            std::printf("%s", usage);
+            return EXIT_SUCCESS;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "%s", usage);
+            return EXIT_FAILURE;
+        }
+        i++;
+    }
+
+    std::FILE* out = output != nullptr ? std::fopen(output, "wb") : stdout;
+    if (out == nullptr) {
+        std::fprintf(stderr, "writing error : cannot open '%s'\n", output);
+        return EXIT_FAILURE;
+    }
+    generator::generator generated(settings, out);
+    bool closed = output == nullptr || std::fclose(out) == 0;
+    if (generated.error().has_value() || !closed) {
+        std::fprintf(stderr, "writing error : %s\n", generated.error().value_or("closing failed").c_str());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <ast/arena.hpp>
+
+namespace monoa::ast {
+
+arena::arena(policy policy, std::size_t block_size) : allocation_policy(policy), block_size(block_size)
+{
+}
+
+arena::~arena()
+{
+    for (void* block : this->blocks) {
+        ::operator delete(block);
+    }
+}
+
+auto arena::copy(std::string_view text) -> std::string_view
+{
+    if (text.empty()) {
+        return {};
+    }
+    auto* data = static_cast<char*>(this->allocate(text.size(), 1));
+    std::memcpy(data, text.data(), text.size());
+    return {data, text.size()};
+}
+
+auto arena::bytes_used() -> std::size_t
+{
+    return this->used;
+}
+
+auto arena::bytes_reserved() -> std::size_t
+{
+    return this->reserved;
+}
+
+auto arena::object_count() -> std::size_t
+{
+    return this->made;
+}
+
+auto arena::do_allocate(std::size_t bytes, std::size_t alignment) -> void*
+{
+    this->used += bytes;
+
+    if (this->allocation_policy == policy::heap || bytes + alignment > this->block_size / 4) {
+        // Large requests get a block of their own so they do not waste the current one.
+        void* block = ::operator new(bytes + alignment);
+        this->blocks.push_back(block);
+        this->reserved += bytes + alignment;
+        auto address = reinterpret_cast<std::uintptr_t>(block);
+        return reinterpret_cast<void*>((address + alignment - 1) & ~(alignment - 1));
+    }
+
+    auto address = reinterpret_cast<std::uintptr_t>(this->cursor);
+    auto aligned = (address + alignment - 1) & ~(alignment - 1);
+    if (this->cursor == nullptr || aligned + bytes > reinterpret_cast<std::uintptr_t>(this->limit)) {
+        this->cursor = static_cast<char*>(::operator new(this->block_size));
+        this->limit = this->cursor + this->block_size;
+        this->blocks.push_back(this->cursor);
+        this->reserved += this->block_size;
+        address = reinterpret_cast<std::uintptr_t>(this->cursor);
+        aligned = (address + alignment - 1) & ~(alignment - 1);
+    }
+    this->cursor = reinterpret_cast<char*>(aligned + bytes);
+    return reinterpret_cast<void*>(aligned);
+}
+
+// Memory is only given back by ~arena, with either policy.
+auto arena::do_deallocate(void* /* p */, std::size_t /* bytes */, std::size_t /* alignment */) -> void
+{
+}
+
+auto arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool
+{
+    return this == &other;
+}
+
+} // namespace monoa::ast
@@ -0,0 +1,81 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_AST_ARENA_HPP
+#define MONOA_AST_ARENA_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace monoa::ast {
+
+// Memory resource owning every node of a tree. Nothing allocated from it is
+// destroyed one by one, the whole tree goes away with the arena, so whatever
+// lives in it must either be trivially destructible or allocate from it too.
+class arena : public std::pmr::memory_resource
+{
+public:
+    enum class policy
+    {
+        // Bump allocate from large blocks, freed in O(blocks).
+        block,
+        // One heap allocation per request, kept for comparison with nodes
+        // allocated on their own. ~arena frees them in O(requests).
+        heap,
+    };
+
+    arena(policy policy = policy::block, std::size_t block_size = 64 * 1024);
+    arena(const arena&) = delete;
+    auto operator=(const arena&) -> arena& = delete;
+    ~arena() override;
+
+    template <typename T, typename... Args>
+    auto make(Args&&... args) -> T*
+    {
+        this->made++;
+        return new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    auto copy(std::string_view text) -> std::string_view;
+    auto bytes_used() -> std::size_t;
+    auto bytes_reserved() -> std::size_t;
+    // Objects made by make, the nodes of a tree.
+    auto object_count() -> std::size_t;
+
+private:
+    policy allocation_policy;
+    std::size_t block_size;
+    std::vector<void*> blocks;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    std::size_t used = 0;
+    std::size_t reserved = 0;
+    std::size_t made = 0;
+
+    auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override;
+    auto do_deallocate(void* p, std::size_t bytes, std::size_t alignment) -> void override;
+    auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override;
+};
+
+} // namespace monoa::ast
+
+#endif // MONOA_AST_ARENA_HPP
@@ -21,6 +21,97 @@
 
 namespace monoa::ast {
 
+auto is_unsigned(basic_type type) -> bool
+{
+    switch (type) {
+    case basic_type::u8:
+    case basic_type::u16:
+    case basic_type::u32:
+    case basic_type::u64:
+        return true;
+        break;
+    default:
+        return false;
+    }
+}
+
+auto type_name(basic_type type) -> const char*
+{
+    switch (type) {
+    case basic_type::u8:
+        return "u8";
+    case basic_type::i8:
+        return "i8";
+    case basic_type::u16:
+        return "u16";
+    case basic_type::i16:
+        return "i16";
+    case basic_type::u32:
+        return "u32";
+    case basic_type::i32:
+        return "i32";
+    case basic_type::u64:
+        return "u64";
+    case basic_type::i64:
+        return "i64";
+    case basic_type::f32:
+        return "f32";
+    case basic_type::f64:
+        return "f64";
+    default:
+        return "unknow";
+    }
+}
+
+auto common_type(basic_type left, basic_type right) -> basic_type
+{
+    if (left == right) {
+        return left;
+    }
+    auto lower = left > right ? right : left;
+    auto higher = left > right ? left : right;
+    switch (higher) {
+    case basic_type::i64:
+        return basic_type::i64;
+    case basic_type::u64:
+        if (is_unsigned(lower)) {
+            return basic_type::u64;
+        } else {
+            return basic_type::i64;
+        }
+    case basic_type::i32:
+        return basic_type::i32;
+    case basic_type::u32:
+        if (is_unsigned(lower)) {
+            return basic_type::u32;
+        } else {
+            return basic_type::i32;
+        }
+    case basic_type::i16:
+        return basic_type::i16;
+    case basic_type::u16:
+        if (is_unsigned(lower)) {
+            return basic_type::u16;
+        } else {
+            return basic_type::i16;
+        }
+    case basic_type::i8:
+        return basic_type::i8;
+    case basic_type::u8:
+        if (is_unsigned(lower)) {
+            return basic_type::u8;
+        } else {
+            return basic_type::i8;
+        }
+    default:
+        return right;
+    }
+}
+
+root::root(arena::policy policy) : memory(policy)
+{
+}
+
 auto root::accept(visitor* visitor) -> void
 {
     return visitor->visit(this);
@@ -31,13 +122,18 @@ auto literal::accept(visitor* visitor) -> void
     visitor->visit(this);
 }
 
+auto variable_reference::accept(visitor* visitor) -> void
+{
+    visitor->visit(this);
+}
+
 auto unary_operation::accept(visitor* visitor) -> void
 {
     visitor->visit(this);
 }
 
-binary_operation::binary_operation(std::unique_ptr<expression> left, operation op, std::unique_ptr<expression> right)
-    : left(std::move(left)), op(op), right(std::move(right))
+binary_operation::binary_operation(expression* left, operation op, expression* right)
+    : left(left), op(op), right(right)
 {
 }
 
@@ -46,6 +142,10 @@ auto binary_operation::accept(visitor* visitor) -> void
     visitor->visit(this);
 }
 
+compound_statement::compound_statement(arena* memory) : statements(memory)
+{
+}
+
 auto compound_statement::accept(visitor* visitor) -> void
 {
     visitor->visit(this);
@@ -56,6 +156,11 @@ auto variable_declaration::accept(visitor* visitor) -> void
     visitor->visit(this);
 }
 
+function_declaration::function_declaration(arena* memory)
+    : parameters(memory), statement_list(memory->make<compound_statement>(memory))
+{
+}
+
 auto function_declaration::accept(visitor* visitor) -> void
 {
     visitor->visit(this);
@@ -19,16 +19,19 @@
 #ifndef MONOA_AST_AST_HPP
 #define MONOA_AST_AST_HPP
 
-#include <memory>
-#include <string>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
 #include <variant>
 #include <vector>
+#include <ast/arena.hpp>
+#include <support/interner.hpp>
 
 namespace monoa::ast {
 
 class visitor;
 
-enum class operation
+enum class operation : std::uint8_t
 {
     assignment,
     assignment_add,
@@ -44,7 +47,7 @@ enum class operation
     negation,
 };
 
-enum class basic_type
+enum class basic_type : std::uint8_t
 {
     unknow,
 
@@ -64,6 +67,11 @@ enum class basic_type
     f64
 };
 
+auto type_name(basic_type type) -> const char*;
+auto is_unsigned(basic_type type) -> bool;
+// Type of an operation between two operands, following the promotion rules of the compiler.
+auto common_type(basic_type left, basic_type right) -> basic_type;
+
 class node
 {
 public:
@@ -94,11 +102,21 @@ public:
     basic_type type;
 };
 
+// Nodes are allocated from the arena of their root and are never destroyed
+// individually, children are plain pointers and lists allocate from the arena.
+
 class literal : public expression
 {
 public:
     std::variant<int8_t, int16_t, int32_t, int64_t, uint8_t, uint16_t, uint32_t, uint64_t, float, double> value;
-    std::unique_ptr<scalar_type> type;
+    scalar_type type = basic_type::unknow;
+    auto accept(visitor* visitor) -> void override;
+};
+
+class variable_reference : public expression
+{
+public:
+    support::symbol name = 0;
     auto accept(visitor* visitor) -> void override;
 };
 
@@ -106,65 +124,71 @@ class unary_operation : public expression
 {
 public:
     operation op;
-    std::unique_ptr<expression> right;
+    expression* right = nullptr;
     auto accept(visitor* visitor) -> void override;
 };
 
 class binary_operation : public expression
 {
 public:
-    binary_operation(std::unique_ptr<expression> left, operation op, std::unique_ptr<expression> right);
-    std::unique_ptr<expression> left;
+    binary_operation(expression* left, operation op, expression* right);
+    expression* left;
     operation op;
-    std::unique_ptr<expression> right;
+    expression* right;
     auto accept(visitor* visitor) -> void override;
 };
 
 class compound_statement : public statement
 {
 public:
-    std::vector<std::unique_ptr<statement>> statements;
+    compound_statement(arena* memory);
+    std::pmr::vector<statement*> statements;
     auto accept(visitor* visitor) -> void override;
 };
 
 class variable_declaration : public statement
 {
 public:
-    std::string name;
-    std::unique_ptr<type> type_name;
-    std::unique_ptr<expression> expr;
+    support::symbol name = 0;
+    type* type_name = nullptr;
+    expression* expr = nullptr;
     auto accept(visitor* visitor) -> void override;
 };
 
 class function_parameter : public node
 {
-    std::string name;
-    std::unique_ptr<type> parameter_type;
+    support::symbol name = 0;
+    type* parameter_type = nullptr;
     auto accept(visitor* visitor) -> void override;
 };
 
 class function_declaration : public statement
 {
 public:
-    std::string name;
-    std::vector<std::unique_ptr<function_parameter>> parameters;
-    std::unique_ptr<type> return_type;
-    std::unique_ptr<compound_statement> statement_list = std::make_unique<compound_statement>();
+    function_declaration(arena* memory);
+    support::symbol name = 0;
+    std::pmr::vector<function_parameter*> parameters;
+    type* return_type = nullptr;
+    compound_statement* statement_list;
     auto accept(visitor* visitor) -> void override;
 };
 
 class return_statement : public statement
 {
 public:
-    std::unique_ptr<expression> return_value;
+    expression* return_value = nullptr;
     auto accept(visitor* visitor) -> void override;
 };
 
 class root : public node
 {
 public:
+    root(arena::policy policy = arena::policy::block);
     auto accept(visitor* visitor) -> void;
-    std::unique_ptr<compound_statement> statement_list;
+    arena memory;
+    compound_statement* statement_list = nullptr;
+    // Names of the symbols in the tree, kept alive by whoever lexed it.
+    const support::interner* symbols = nullptr;
 };
 
 } // namespace monoa::ast
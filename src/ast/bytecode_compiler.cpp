@@ -0,0 +1,315 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <ast/bytecode_compiler.hpp>
+
+namespace monoa::ast {
+
+bytecode_compiler::bytecode_compiler(root* ast) : symbols(ast->symbols)
+{
+    this->visit(ast);
+}
+
+auto bytecode_compiler::result() -> const vm::program&
+{
+    return this->compiled;
+}
+
+auto bytecode_compiler::error() -> std::optional<std::string>
+{
+    return this->error_string;
+}
+
+auto bytecode_compiler::visit(root* node) -> void
+{
+    if (this->has_error()) {
+        return;
+    }
+    node->statement_list->accept(this);
+}
+
+auto bytecode_compiler::visit(literal* node) -> void
+{
+    this->result_value = value{true, 0, node->type.type};
+    switch (node->type.type) {
+    case basic_type::i8:
+        this->result_value.data = std::get<int8_t>(node->value);
+        break;
+    case basic_type::u8:
+        this->result_value.data = std::get<uint8_t>(node->value);
+        break;
+    case basic_type::i16:
+        this->result_value.data = std::get<int16_t>(node->value);
+        break;
+    case basic_type::u16:
+        this->result_value.data = std::get<uint16_t>(node->value);
+        break;
+    case basic_type::i32:
+        this->result_value.data = std::get<int32_t>(node->value);
+        break;
+    case basic_type::u32:
+        this->result_value.data = std::get<uint32_t>(node->value);
+        break;
+    case basic_type::i64:
+        this->result_value.data = std::get<int64_t>(node->value);
+        break;
+    case basic_type::u64:
+        this->result_value.data = std::get<uint64_t>(node->value);
+        break;
+    default:
+        this->error_string = "unsupported literal type";
+        break;
+    }
+}
+
+auto bytecode_compiler::visit(variable_reference* node) -> void
+{
+    if (this->has_error()) {
+        return;
+    }
+    this->lookup(node->name);
+}
+
+auto bytecode_compiler::visit(unary_operation* node) -> void
+{
+    if (this->has_error()) {
+        return;
+    }
+    auto mark = this->next_temporary;
+    node->right->accept(this);
+    if (node->op != operation::negation) {
+        this->error_string = "unexpected operator";
+        return;
+    }
+    auto right = this->result_value;
+    this->lower_operation(operation::subtraction, value{true, 0, right.type}, right);
+    this->release(mark);
+}
+
+auto bytecode_compiler::visit(binary_operation* node) -> void
+{
+    if (this->has_error()) {
+        return;
+    }
+    auto mark = this->next_temporary;
+    node->left->accept(this);
+    auto left = this->result_value;
+    node->right->accept(this);
+    this->lower_operation(node->op, left, this->result_value);
+    this->release(mark);
+}
+
+auto bytecode_compiler::visit(compound_statement* node) -> void
+{
+    if (this->has_error()) {
+        return;
+    }
+    auto scope = this->locals.size();
+    auto scope_temporary = this->next_temporary;
+    for (auto* statement : node->statements) {
+        auto declared = this->locals.size();
+        auto mark = this->next_temporary;
+        statement->accept(this);
+        // A declaration keeps the register of its value.
+        if (this->locals.size() == declared) {
+            this->next_temporary = mark;
+        }
+    }
+    this->locals.resize(scope);
+    this->next_temporary = scope_temporary;
+}
+
+auto bytecode_compiler::visit(variable_declaration* node) -> void
+{
+    if (this->has_error()) {
+        return;
+    }
+    node->expr->accept(this);
+    this->locals.push_back(local{node->name, this->result_value});
+}
+
+auto bytecode_compiler::visit(function_declaration* node) -> void
+{
+    if (this->has_error()) {
+        return;
+    }
+    this->begin_function(node->name);
+    node->statement_list->accept(this);
+    this->end_function();
+}
+
+auto bytecode_compiler::visit(function_parameter*) -> void
+{
+    if (this->has_error()) {
+        return;
+    }
+}
+
+auto bytecode_compiler::visit(return_statement* node) -> void
+{
+    if (this->has_error()) {
+        return;
+    }
+    node->return_value->accept(this);
+    if (this->function == nullptr) {
+        this->error_string = "return outside of a function";
+        return;
+    }
+    this->code.push_back(pending{vm::opcode::ret, 0, this->operand(this->result_value), 0});
+}
+
+auto bytecode_compiler::has_error() -> bool
+{
+    return this->error_string.has_value();
+}
+
+auto bytecode_compiler::lookup(support::symbol name) -> void
+{
+    for (auto it = this->locals.rbegin(); it != this->locals.rend(); it++) {
+        if (it->name == name) {
+            this->result_value = it->bound;
+            return;
+        }
+    }
+    this->error_string = "undefined variable '" + std::string(this->symbols->name(name)) + "'";
+}
+
+// Appends the operation with no target yet, callers give it one once the
+// temporaries of its operands are released.
+auto bytecode_compiler::lower_operation(operation op, value left, value right) -> void
+{
+    vm::opcode code;
+    switch (op) {
+    case operation::addition:
+        code = vm::opcode::add_u8;
+        break;
+    case operation::subtraction:
+        code = vm::opcode::sub_u8;
+        break;
+    case operation::multiplication:
+        code = vm::opcode::mul_u8;
+        break;
+    case operation::division:
+        code = vm::opcode::div_u8;
+        break;
+    default:
+        this->error_string = "unexpected operator";
+        return;
+    }
+    if (this->function == nullptr) {
+        this->error_string = "expression outside of a function";
+        return;
+    }
+
+    auto type = common_type(left.type, right.type);
+    auto typed = vm::typed(code, type);
+    if (!typed.has_value()) {
+        this->error_string = "unsupported operation type " + std::string(type_name(type));
+        return;
+    }
+    // A register operand of another type is copied into a new temporary by
+    // the convert instruction of the operation's type, and the operation
+    // reads the copy. Constants are read as they are. There is no convert
+    // to 64 bit types, such operands are read unchanged.
+    for (auto* side : {&left, &right}) {
+        auto converted = vm::convert(type);
+        if (!side->constant && side->type != type && converted.has_value()) {
+            auto target = this->allocate();
+            this->code.push_back(pending{converted.value(), target, this->operand(*side), 0});
+            *side = value{false, target, type};
+        }
+    }
+    this->code.push_back(pending{typed.value(), 0, this->operand(left), this->operand(right)});
+    this->result_value = value{false, 0, type};
+}
+
+auto bytecode_compiler::operand(value operand) -> std::uint32_t
+{
+    if (!operand.constant) {
+        return static_cast<std::uint32_t>(operand.data);
+    }
+    auto [it, inserted] =
+        this->constant_ids.emplace(operand.data, static_cast<std::uint32_t>(this->function->constants.size()));
+    if (inserted) {
+        this->function->constants.push_back(operand.data);
+    }
+    return it->second | constant_flag;
+}
+
+auto bytecode_compiler::allocate() -> std::uint32_t
+{
+    auto temporary = this->next_temporary++;
+    this->temporary_count = std::max(this->temporary_count, this->next_temporary);
+    return temporary;
+}
+
+// Temporaries of the operands are free once the operation just lowered has
+// read them, its result takes the first of them.
+auto bytecode_compiler::release(std::uint32_t mark) -> void
+{
+    this->next_temporary = mark;
+    if (!this->has_error()) {
+        auto target = this->allocate();
+        this->code.back().target = target;
+        this->result_value.data = target;
+    }
+}
+
+auto bytecode_compiler::begin_function(support::symbol name) -> void
+{
+    this->function = &this->compiled.functions.emplace_back();
+    this->function->name = std::string(this->symbols->name(name));
+    this->code.clear();
+    this->constant_ids.clear();
+    this->next_temporary = 0;
+    this->temporary_count = 0;
+}
+
+// Temporaries go after the constants, the frame copies those in first.
+auto bytecode_compiler::end_function() -> void
+{
+    if (!this->has_error() && (this->code.empty() || this->code.back().code != vm::opcode::ret)) {
+        this->code.push_back(pending{vm::opcode::ret, 0, this->operand(value{true, 0, basic_type::i64}), 0});
+    }
+    auto constant_count = static_cast<std::uint32_t>(this->function->constants.size());
+    auto register_count = constant_count + this->temporary_count;
+    if (!this->has_error() && register_count > 0x10000) {
+        this->error_string = "function '" + this->function->name + "' needs more than 65536 registers";
+    }
+    if (!this->has_error()) {
+        auto number = [constant_count](std::uint32_t id) {
+            return static_cast<std::uint16_t>((id & constant_flag) != 0 ? id & ~constant_flag : constant_count + id);
+        };
+        this->function->register_count = register_count;
+        this->function->code.reserve(this->code.size());
+        for (const auto& instruction : this->code) {
+            auto& lowered = this->function->code.emplace_back(vm::instruction{instruction.code});
+            lowered.left = number(instruction.left);
+            if (instruction.code != vm::opcode::ret) {
+                lowered.target = number(instruction.target);
+            }
+            if (instruction.code < vm::opcode::convert_u8) {
+                lowered.right = number(instruction.right);
+            }
+        }
+    }
+    this->function = nullptr;
+}
+
+} // namespace monoa::ast
@@ -0,0 +1,105 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_AST_BYTECODE_COMPILER_HPP
+#define MONOA_AST_BYTECODE_COMPILER_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ast/ast.hpp>
+#include <ast/visitor.hpp>
+#include <vm/bytecode.hpp>
+
+namespace monoa::ast {
+
+// Lowers the tree into register bytecode for vm::interpreter, with the same
+// typing and results as compiler. Registers holding temporaries are reused
+// once the statement using them is done.
+class bytecode_compiler : public visitor
+{
+public:
+    bytecode_compiler(root* ast);
+    auto result() -> const vm::program&;
+    auto error() -> std::optional<std::string>;
+
+    auto visit(root* node) -> void override;
+    auto visit(literal* node) -> void override;
+    auto visit(variable_reference* node) -> void override;
+    auto visit(unary_operation* node) -> void override;
+    auto visit(binary_operation* node) -> void override;
+    auto visit(compound_statement* node) -> void override;
+    auto visit(variable_declaration* node) -> void override;
+    auto visit(function_declaration* node) -> void override;
+    auto visit(function_parameter* node) -> void override;
+    auto visit(return_statement* node) -> void override;
+
+private:
+    // A constant, or the temporary register of a value.
+    struct value
+    {
+        bool constant = false;
+        std::uint64_t data = 0;
+        basic_type type = basic_type::unknow;
+    };
+
+    struct local
+    {
+        support::symbol name;
+        value bound;
+    };
+
+    // Instructions of the current function, constants and temporaries are
+    // numbered apart until its constants are all known.
+    struct pending
+    {
+        vm::opcode code;
+        std::uint32_t target;
+        std::uint32_t left;
+        std::uint32_t right;
+    };
+
+    static constexpr std::uint32_t constant_flag = 0x80000000;
+
+    std::optional<std::string> error_string;
+    const support::interner* symbols;
+    vm::program compiled;
+    value result_value;
+    std::vector<local> locals;
+
+    vm::function* function = nullptr;
+    std::vector<pending> code;
+    std::unordered_map<std::uint64_t, std::uint32_t> constant_ids;
+    std::uint32_t next_temporary = 0;
+    std::uint32_t temporary_count = 0;
+
+    auto has_error() -> bool;
+    auto lookup(support::symbol name) -> void;
+    auto lower_operation(operation op, value left, value right) -> void;
+    auto operand(value operand) -> std::uint32_t;
+    auto allocate() -> std::uint32_t;
+    auto release(std::uint32_t mark) -> void;
+    auto begin_function(support::symbol name) -> void;
+    auto end_function() -> void;
+};
+
+} // namespace monoa::ast
+
+#endif // MONOA_AST_BYTECODE_COMPILER_HPP
@@ -16,40 +16,31 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <iomanip>
-#include <iostream>
 #include <ast/compiler.hpp>
 
-namespace {
-
-const char* prelude =
-    R"(global _start
-_start:
-    sub rsp, 8
-    call main
-    mov rdi, rax
-    mov rax, 60
-    syscall
-)";
+namespace monoa::ast {
 
+compiler::compiler(ast::root* ast, backend::options options) : symbols(ast->symbols), settings(options)
+{
+    {
+        support::scoped_timer timer(options.timer, "lower", "nodes", ast->memory.object_count());
+        this->visit(ast);
+    }
+    this->generate();
 }
 
-namespace monoa::ast {
-
-compiler::compiler(ast::root* ast)
+compiler::compiler(const flat_tree* ast, backend::options options) : symbols(ast->symbols), settings(options)
 {
-    this->visit(ast);
+    {
+        support::scoped_timer timer(options.timer, "lower", "nodes", ast->size());
+        this->compile(ast);
+    }
+    this->generate();
 }
 
 auto compiler::result() -> std::string
 {
-    std::string result;
-    result += "section .data\n";
-    result += this->section_data;
-    result += "section .text\n";
-    result += prelude;
-    result += this->section_text;
-    return result;
+    return this->backend.has_value() ? this->backend->result() : std::string();
 }
 
 auto compiler::error() -> std::optional<std::string>
@@ -57,71 +48,32 @@ auto compiler::error() -> std::optional<std::string>
     return this->error_string;
 }
 
-auto compiler::is_unsigned(basic_type type) -> bool
+auto compiler::ir_module() -> const ir::module*
 {
-    switch (type) {
-    case basic_type::u8:
-    case basic_type::u16:
-    case basic_type::u32:
-    case basic_type::u64:
-        return true;
-        break;
-    default:
-        return false;
-    }
+    return &this->lowered;
+}
+
+auto compiler::peephole_reports() -> const std::vector<backend::peephole_report>&
+{
+    static const std::vector<backend::peephole_report> none;
+    return this->backend.has_value() ? this->backend->peephole_reports() : none;
+}
+
+auto compiler::program() -> const backend::assembly&
+{
+    static const backend::assembly none;
+    return this->backend.has_value() ? this->backend->program() : none;
+}
+
+auto compiler::functions() -> const std::vector<backend::emitted_function>&
+{
+    static const std::vector<backend::emitted_function> none;
+    return this->backend.has_value() ? this->backend->functions() : none;
 }
 
 auto compiler::set_result_type(basic_type type) -> void
 {
-    if (this->result_type == type) {
-        return;
-    }
-    auto lower = this->result_type > type ? type : this->result_type;
-    auto higher = this->result_type > type ? this->result_type : type;
-    switch (higher) {
-    case basic_type::i64:
-        this->result_type = basic_type::i64;
-        break;
-    case basic_type::u64:
-        if (is_unsigned(lower)) {
-            this->result_type = basic_type::u64;
-        } else {
-            this->result_type = basic_type::i64;
-        }
-        break;
-    case basic_type::i32:
-        this->result_type = basic_type::i32;
-        break;
-    case basic_type::u32:
-        if (is_unsigned(lower)) {
-            this->result_type = basic_type::u32;
-        } else {
-            this->result_type = basic_type::i32;
-        }
-        break;
-    case basic_type::i16:
-        this->result_type = basic_type::i16;
-        break;
-    case basic_type::u16:
-        if (is_unsigned(lower)) {
-            this->result_type = basic_type::u16;
-        } else {
-            this->result_type = basic_type::i16;
-        }
-        break;
-    case basic_type::i8:
-        this->result_type = basic_type::i8;
-        break;
-    case basic_type::u8:
-        if (is_unsigned(lower)) {
-            this->result_type = basic_type::u8;
-        } else {
-            this->result_type = basic_type::i8;
-        }
-        break;
-    default:
-        this->result_type = type;
-    }
+    this->result_type = common_type(this->result_type, type);
 }
 
 auto compiler::visit(ast::root* node) -> void
@@ -134,42 +86,62 @@ auto compiler::visit(ast::root* node) -> void
 
 auto compiler::visit(ast::literal* node) -> void
 {
-    this->set_result_type(node->type->type);
-    switch (node->type->type) {
+    this->result_type = node->type.type;
+    this->result_value.kind = ir::operand::kind::constant;
+    switch (node->type.type) {
     case ast::basic_type::i8:
-        this->push(std::get<int8_t>(node->value));
+        this->result_value.data = std::get<int8_t>(node->value);
         break;
     case ast::basic_type::u8:
-        this->push(std::get<uint8_t>(node->value));
+        this->result_value.data = std::get<uint8_t>(node->value);
         break;
     case ast::basic_type::i16:
-        this->push(std::get<int16_t>(node->value));
+        this->result_value.data = std::get<int16_t>(node->value);
         break;
     case ast::basic_type::u16:
-        this->push(std::get<uint16_t>(node->value));
+        this->result_value.data = std::get<uint16_t>(node->value);
         break;
     case ast::basic_type::i32:
-        this->push(std::get<int32_t>(node->value));
+        this->result_value.data = std::get<int32_t>(node->value);
         break;
     case ast::basic_type::u32:
-        this->push(std::get<uint32_t>(node->value));
+        this->result_value.data = std::get<uint32_t>(node->value);
         break;
     case ast::basic_type::i64:
-        this->push(std::get<int64_t>(node->value));
+        this->result_value.data = std::get<int64_t>(node->value);
         break;
     case ast::basic_type::u64:
-        this->push(std::get<uint64_t>(node->value));
+        this->result_value.data = std::get<uint64_t>(node->value);
         break;
     default:
+        this->error_string = "unsupported literal type";
         break;
     }
 }
 
+auto compiler::visit(ast::variable_reference* node) -> void
+{
+    if (this->has_error()) {
+        return;
+    }
+    this->lookup(node->name);
+}
+
 auto compiler::visit(ast::unary_operation* node) -> void
 {
     if (this->has_error()) {
         return;
     }
+    node->right->accept(this);
+    if (node->op != operation::negation) {
+        this->error_string = "unexpected operator";
+        return;
+    }
+    this->lower_operation(operation::subtraction,
+                          ir::operand::constant(0),
+                          this->result_type,
+                          this->result_value,
+                          this->result_type);
 }
 
 auto compiler::visit(ast::binary_operation* node) -> void
@@ -178,44 +150,10 @@ auto compiler::visit(ast::binary_operation* node) -> void
         return;
     }
     node->left->accept(this);
+    auto left = this->result_value;
+    auto left_type = this->result_type;
     node->right->accept(this);
-    switch (node->op) {
-    case ast::operation::addition:
-        this->pop("rbx");
-        this->pop("rax");
-        this->command("add rax, rbx");
-        this->push("rax");
-        break;
-    case ast::operation::subtraction:
-        this->pop("rbx");
-        this->pop("rax");
-        this->command("sub rax, rbx");
-        this->push("rax");
-        break;
-    case ast::operation::multiplication:
-        this->pop("rbx");
-        this->pop("rax");
-        if (this->is_unsigned(this->result_type)) {
-            this->command("imul rbx");
-        } else {
-            this->command("mul rbx");
-        }
-        this->push("rax");
-        break;
-    case ast::operation::division:
-        this->pop("rbx");
-        this->pop("rax");
-        if (this->is_unsigned(this->result_type)) {
-            this->command("idiv rbx");
-        } else {
-            this->command("div rbx");
-        }
-        this->push("rax");
-        break;
-    default:
-        this->error_string = "unexpected operator";
-    }
-    this->result_type = basic_type::unknow;
+    this->lower_operation(node->op, left, left_type, this->result_value, this->result_type);
 }
 
 auto compiler::visit(ast::compound_statement* node) -> void
@@ -223,9 +161,11 @@ auto compiler::visit(ast::compound_statement* node) -> void
     if (this->has_error()) {
         return;
     }
-    for (auto& statement : node->statements) {
+    auto scope = this->local_vars.size();
+    for (auto* statement : node->statements) {
         statement->accept(this);
     }
+    this->local_vars.resize(scope);
 }
 
 auto compiler::visit(ast::variable_declaration* node) -> void
@@ -233,7 +173,8 @@ auto compiler::visit(ast::variable_declaration* node) -> void
     if (this->has_error()) {
         return;
     }
-    this->push(0);
+    node->expr->accept(this);
+    this->local_vars.push_back(local_var{node->name, this->result_value, this->result_type});
 }
 
 auto compiler::visit(ast::function_declaration* node) -> void
@@ -241,16 +182,9 @@ auto compiler::visit(ast::function_declaration* node) -> void
     if (this->has_error()) {
         return;
     }
-    this->label("global " + node->name + ":function");
-    this->label(node->name + ":");
+    this->begin_function(node->name);
     node->statement_list->accept(this);
-    this->pop("rax");
-
-    if (this->stack_length > 0) {
-        this->command("add rsp, " + std::to_string(this->stack_length));
-    }
-
-    this->command("ret");
+    this->end_function();
 }
 
 auto compiler::visit(ast::function_parameter* node) -> void
@@ -266,6 +200,75 @@ auto compiler::visit(ast::return_statement* node) -> void
         return;
     }
     node->return_value->accept(this);
+    this->lower_return(this->result_value);
+}
+
+auto compiler::compile(const flat_tree* tree) -> void
+{
+    struct typed_operand
+    {
+        ir::operand value;
+        basic_type type;
+    };
+    std::vector<typed_operand> operands;
+    // Variables declared before each open compound statement.
+    std::vector<std::size_t> scopes;
+
+    auto pop = [&operands]() {
+        auto top = operands.back();
+        operands.pop_back();
+        return top;
+    };
+
+    for (flat_tree::index i = 0; i < tree->size() && !this->has_error(); i++) {
+        switch (tree->kinds[i]) {
+        case flat_tree::kind::literal:
+            operands.push_back({ir::operand::constant(tree->values[i]), tree->types[i]});
+            break;
+        case flat_tree::kind::variable_reference:
+            this->lookup(static_cast<support::symbol>(tree->values[i]));
+            operands.push_back({this->result_value, this->result_type});
+            break;
+        case flat_tree::kind::unary_operation: {
+            auto right = pop();
+            this->lower_operation(
+                operation::subtraction, ir::operand::constant(0), right.type, right.value, right.type);
+            operands.push_back({this->result_value, this->result_type});
+            break;
+        }
+        case flat_tree::kind::binary_operation: {
+            auto right = pop();
+            auto left = pop();
+            this->lower_operation(tree->operations[i], left.value, left.type, right.value, right.type);
+            operands.push_back({this->result_value, this->result_type});
+            break;
+        }
+        case flat_tree::kind::scope_begin:
+            scopes.push_back(this->local_vars.size());
+            break;
+        case flat_tree::kind::compound_statement:
+            this->local_vars.resize(scopes.back());
+            scopes.pop_back();
+            break;
+        case flat_tree::kind::variable_declaration: {
+            auto value = pop();
+            auto name = static_cast<support::symbol>(tree->values[i]);
+            this->local_vars.push_back(local_var{name, value.value, value.type});
+            break;
+        }
+        case flat_tree::kind::return_statement:
+            this->lower_return(pop().value);
+            break;
+        case flat_tree::kind::function_prologue:
+            this->begin_function(static_cast<support::symbol>(tree->values[i]));
+            break;
+        case flat_tree::kind::function_declaration:
+            this->end_function();
+            break;
+        default:
+            break;
+        }
+    }
 }
 
 auto compiler::has_error() -> bool
@@ -273,32 +276,112 @@ auto compiler::has_error() -> bool
     return this->error_string.has_value();
 }
 
-auto compiler::label(std::string lab) -> void
+auto compiler::lookup(support::symbol name) -> void
 {
-    this->section_text += lab + "\n";
+    for (auto it = this->local_vars.rbegin(); it != this->local_vars.rend(); it++) {
+        if (it->name == name) {
+            this->result_value = it->value;
+            this->result_type = it->type;
+            return;
+        }
+    }
+    this->error_string = "undefined variable '" + std::string(this->symbols->name(name)) + "'";
 }
 
-auto compiler::command(std::string cmd) -> void
+auto compiler::lower_operation(
+    operation op, ir::operand left, basic_type left_type, ir::operand right, basic_type right_type) -> void
 {
-    this->section_text += "    " + cmd + "\n";
+    ir::opcode code;
+    switch (op) {
+    case operation::addition:
+        code = ir::opcode::add;
+        break;
+    case operation::subtraction:
+        code = ir::opcode::sub;
+        break;
+    case operation::multiplication:
+        code = ir::opcode::mul;
+        break;
+    case operation::division:
+        code = ir::opcode::div;
+        break;
+    default:
+        this->error_string = "unexpected operator";
+        return;
+    }
+    if (!this->builder.has_value()) {
+        this->error_string = "expression outside of a function";
+        return;
+    }
+    this->reopen_block();
+
+    this->result_type = left_type;
+    this->set_result_type(right_type);
+    // Constants take the type of their instruction, values of another type
+    // are converted first.
+    if (left.is_value() && left_type != this->result_type) {
+        left = this->builder->convert(this->result_type, left);
+    }
+    if (right.is_value() && right_type != this->result_type) {
+        right = this->builder->convert(this->result_type, right);
+    }
+    this->result_value = this->builder->binary(code, this->result_type, left, right);
+}
+
+auto compiler::lower_return(ir::operand value) -> void
+{
+    if (!this->builder.has_value()) {
+        this->error_string = "return outside of a function";
+        return;
+    }
+    this->reopen_block();
+    this->builder->ret(value);
 }
 
-auto compiler::push(uint64_t data) -> void
+// Code following a return still gets lowered, into a block of its own that
+// nothing jumps to.
+auto compiler::reopen_block() -> void
 {
-    this->stack_length += 8;
-    this->command("push " + std::to_string(data));
+    if (this->builder->is_terminated()) {
+        this->builder->set_block(this->builder->create_block());
+    }
+}
+
+auto compiler::begin_function(support::symbol name) -> void
+{
+    auto& function = this->lowered.functions.emplace_back();
+    function.name = std::string(this->symbols->name(name));
+    this->builder.emplace(&function);
 }
 
-auto compiler::push(std::string reg) -> void
+auto compiler::end_function() -> void
 {
-    this->stack_length += 8;
-    this->command("push " + reg);
+    if (!this->has_error() && !this->builder->is_terminated()) {
+        this->builder->ret(ir::operand::constant(0));
+    }
+    this->builder.reset();
 }
 
-auto compiler::pop(std::string reg) -> void
+auto compiler::generate() -> void
 {
-    this->stack_length -= 8;
-    this->command("pop " + reg);
+    if (this->has_error()) {
+        return;
+    }
+    {
+        support::scoped_timer timer(this->settings.timer, "verify", "ir insts");
+        if (timer.active()) {
+            timer.set_items(ir::instruction_count(this->lowered));
+        }
+        if (auto invalid = ir::verify(this->lowered)) {
+            this->error_string = "invalid ir : " + invalid.value();
+            return;
+        }
+    }
+    this->backend.emplace(&this->lowered, this->settings);
+    if (auto error = this->backend->error()) {
+        this->error_string = error;
+        this->backend.reset();
+    }
 }
 
 } // namespace monoa::ast
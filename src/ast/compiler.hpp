@@ -23,25 +23,35 @@
 #include <optional>
 #include <vector>
 #include <ast/ast.hpp>
+#include <ast/flat.hpp>
 #include <ast/visitor.hpp>
+#include <backend/x86.hpp>
+#include <ir/ir.hpp>
 
 namespace monoa::ast {
 
 struct local_var
 {
-    std::string name;
-    unsigned int address;
+    support::symbol name;
+    ir::operand value;
+    basic_type type;
 };
 
 class compiler : public visitor
 {
 public:
-    compiler(root* ast);
+    compiler(root* ast, backend::options options = {});
+    compiler(const flat_tree* ast, backend::options options = {});
     auto result() -> std::string;
     auto error() -> std::optional<std::string>;
+    auto ir_module() -> const ir::module*;
+    auto peephole_reports() -> const std::vector<backend::peephole_report>&;
+    auto program() -> const backend::assembly&;
+    auto functions() -> const std::vector<backend::emitted_function>&;
 
     auto visit(root* node) -> void;
     auto visit(literal* node) -> void;
+    auto visit(variable_reference* node) -> void;
     auto visit(unary_operation* node) -> void;
     auto visit(binary_operation* node) -> void;
     auto visit(compound_statement* node) -> void;
@@ -52,20 +62,27 @@ public:
 
 private:
     std::optional<std::string> error_string;
+    const support::interner* symbols;
     basic_type result_type = basic_type::unknow;
-    std::string section_text;
-    std::string section_data;
-    unsigned int stack_length = 0;
+    ir::operand result_value;
     std::vector<local_var> local_vars;
 
+    backend::options settings;
+    std::optional<backend::x86> backend;
+    ir::module lowered;
+    std::optional<ir::builder> builder;
+
+    auto compile(const flat_tree* tree) -> void;
     auto has_error() -> bool;
-    auto is_unsigned(basic_type type) -> bool;
     auto set_result_type(basic_type type) -> void;
-    auto label(std::string lab) -> void;
-    auto command(std::string cmd) -> void;
-    auto push(uint64_t data) -> void;
-    auto push(std::string reg) -> void;
-    auto pop(std::string reg) -> void;
+    auto lookup(support::symbol name) -> void;
+    auto lower_operation(
+        operation op, ir::operand left, basic_type left_type, ir::operand right, basic_type right_type) -> void;
+    auto lower_return(ir::operand value) -> void;
+    auto reopen_block() -> void;
+    auto begin_function(support::symbol name) -> void;
+    auto end_function() -> void;
+    auto generate() -> void;
 };
 
 } // namespace monoa::ast
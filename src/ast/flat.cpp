@@ -0,0 +1,166 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <type_traits>
+#include <variant>
+#include <ast/flat.hpp>
+#include <ast/visitor.hpp>
+
+namespace {
+
+using namespace monoa::ast;
+
+class flattener : public visitor
+{
+public:
+    flattener(flat_tree* tree) : tree(tree)
+    {
+    }
+
+    flat_tree::index last = flat_tree::none;
+
+    auto visit(root* node) -> void override
+    {
+        node->statement_list->accept(this);
+        this->last = this->tree->add(flat_tree::kind::root, this->last);
+    }
+
+    auto visit(literal* node) -> void override
+    {
+        std::uint64_t bits = std::visit(
+            [](auto value) -> std::uint64_t {
+                if constexpr (std::is_floating_point_v<decltype(value)>) {
+                    double wide = value;
+                    std::uint64_t raw = 0;
+                    std::memcpy(&raw, &wide, sizeof(raw));
+                    return raw;
+                } else {
+                    return static_cast<std::uint64_t>(value);
+                }
+            },
+            node->value);
+        this->last = this->tree->add(flat_tree::kind::literal, flat_tree::none, flat_tree::none, bits);
+        this->tree->types.back() = node->type.type;
+    }
+
+    auto visit(variable_reference* node) -> void override
+    {
+        this->last =
+            this->tree->add(flat_tree::kind::variable_reference, flat_tree::none, flat_tree::none, node->name);
+    }
+
+    auto visit(unary_operation* node) -> void override
+    {
+        node->right->accept(this);
+        this->last = this->tree->add(flat_tree::kind::unary_operation, this->last);
+        this->tree->operations.back() = node->op;
+    }
+
+    auto visit(binary_operation* node) -> void override
+    {
+        node->left->accept(this);
+        auto left = this->last;
+        node->right->accept(this);
+        this->last = this->tree->add(flat_tree::kind::binary_operation, left, this->last);
+        this->tree->operations.back() = node->op;
+    }
+
+    auto visit(compound_statement* node) -> void override
+    {
+        this->tree->add(flat_tree::kind::scope_begin);
+        std::vector<flat_tree::index> children;
+        children.reserve(node->statements.size());
+        for (auto* statement : node->statements) {
+            statement->accept(this);
+            children.push_back(this->last);
+        }
+        auto offset = static_cast<flat_tree::index>(this->tree->lists.size());
+        this->tree->lists.insert(this->tree->lists.end(), children.begin(), children.end());
+        this->last = this->tree->add(
+            flat_tree::kind::compound_statement, offset, static_cast<flat_tree::index>(children.size()));
+    }
+
+    auto visit(variable_declaration* node) -> void override
+    {
+        node->expr->accept(this);
+        this->last =
+            this->tree->add(flat_tree::kind::variable_declaration, this->last, flat_tree::none, node->name);
+    }
+
+    auto visit(function_declaration* node) -> void override
+    {
+        this->tree->add(flat_tree::kind::function_prologue, flat_tree::none, flat_tree::none, node->name);
+        node->statement_list->accept(this);
+        this->last =
+            this->tree->add(flat_tree::kind::function_declaration, this->last, flat_tree::none, node->name);
+    }
+
+    auto visit(function_parameter*) -> void override
+    {
+    }
+
+    auto visit(return_statement* node) -> void override
+    {
+        node->return_value->accept(this);
+        this->last = this->tree->add(flat_tree::kind::return_statement, this->last);
+    }
+
+private:
+    flat_tree* tree;
+};
+
+} // namespace
+
+namespace monoa::ast {
+
+flat_tree::flat_tree(root* ast) : symbols(ast->symbols)
+{
+    flattener flattener(this);
+    flattener.visit(ast);
+}
+
+auto flat_tree::size() const -> index
+{
+    return static_cast<index>(this->kinds.size());
+}
+
+auto flat_tree::root_index() const -> index
+{
+    return this->size() - 1;
+}
+
+auto flat_tree::bytes_used() const -> std::size_t
+{
+    std::size_t per_node =
+        sizeof(kind) + sizeof(operation) + sizeof(basic_type) + 2 * sizeof(index) + sizeof(std::uint64_t);
+    return this->kinds.size() * per_node + this->lists.size() * sizeof(index);
+}
+
+auto flat_tree::add(kind kind, index first, index second, std::uint64_t value) -> index
+{
+    this->kinds.push_back(kind);
+    this->operations.push_back(operation::addition);
+    this->types.push_back(basic_type::unknow);
+    this->first.push_back(first);
+    this->second.push_back(second);
+    this->values.push_back(value);
+    return this->size() - 1;
+}
+
+} // namespace monoa::ast
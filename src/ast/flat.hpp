@@ -0,0 +1,73 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_AST_FLAT_HPP
+#define MONOA_AST_FLAT_HPP
+
+#include <cstdint>
+#include <vector>
+#include <ast/ast.hpp>
+
+namespace monoa::ast {
+
+// Struct-of-arrays copy of a syntax tree. Nodes are stored in post-order, so
+// every child has a smaller index than its parent and a front to back walk
+// visits operands before the operations using them. Lists of children
+// (statements) live in `lists`, referenced by offset and length.
+class flat_tree
+{
+public:
+    using index = std::uint32_t;
+    static constexpr index none = ~index{0};
+
+    enum class kind : std::uint8_t
+    {
+        literal,              // values: bits of the value, types: its type
+        variable_reference,   // values: symbol
+        unary_operation,      // first: operand
+        binary_operation,     // first: left, second: right
+        scope_begin,          // placed before the statements of a compound statement
+        compound_statement,   // first: offset in lists, second: count
+        variable_declaration, // first: expression, values: symbol
+        function_prologue,    // values: symbol, placed before the body
+        function_declaration, // first: body, values: symbol
+        return_statement,     // first: expression
+        root,                 // first: statement list
+    };
+
+    flat_tree(root* ast);
+    auto size() const -> index;
+    auto root_index() const -> index;
+    auto bytes_used() const -> std::size_t;
+
+    std::vector<kind> kinds;
+    std::vector<operation> operations;
+    std::vector<basic_type> types;
+    std::vector<index> first;
+    std::vector<index> second;
+    std::vector<std::uint64_t> values;
+    std::vector<index> lists;
+    // Names of the symbols in `values`, those of the tree flattened.
+    const support::interner* symbols;
+
+    auto add(kind kind, index first = none, index second = none, std::uint64_t value = 0) -> index;
+};
+
+} // namespace monoa::ast
+
+#endif // MONOA_AST_FLAT_HPP
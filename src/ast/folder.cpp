@@ -0,0 +1,257 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <limits>
+#include <type_traits>
+#include <variant>
+#include <ast/folder.hpp>
+
+namespace {
+
+using namespace monoa::ast;
+
+template <typename T>
+auto in_range(__int128 value) -> bool
+{
+    return value >= static_cast<__int128>(std::numeric_limits<T>::min()) &&
+           value <= static_cast<__int128>(std::numeric_limits<T>::max());
+}
+
+auto fits(basic_type type, __int128 value) -> bool
+{
+    switch (type) {
+    case basic_type::u8:
+        return in_range<uint8_t>(value);
+    case basic_type::i8:
+        return in_range<int8_t>(value);
+    case basic_type::u16:
+        return in_range<uint16_t>(value);
+    case basic_type::i16:
+        return in_range<int16_t>(value);
+    case basic_type::u32:
+        return in_range<uint32_t>(value);
+    case basic_type::i32:
+        return in_range<int32_t>(value);
+    case basic_type::u64:
+        return in_range<uint64_t>(value);
+    case basic_type::i64:
+        return in_range<int64_t>(value);
+    default:
+        return false;
+    }
+}
+
+// Integer value of a literal, floating point literals are left alone.
+auto integer_value(expression* expr) -> std::optional<__int128>
+{
+    auto* lit = dynamic_cast<literal*>(expr);
+    if (lit == nullptr || lit->type.type == basic_type::unknow) {
+        return std::nullopt;
+    }
+    return std::visit(
+        [](auto value) -> std::optional<__int128> {
+            if constexpr (std::is_integral_v<decltype(value)>) {
+                return static_cast<__int128>(value);
+            } else {
+                return std::nullopt;
+            }
+        },
+        lit->value);
+}
+
+} // namespace
+
+namespace monoa::ast {
+
+folder::folder(root* ast) : memory(&ast->memory), symbols(ast->symbols)
+{
+    this->visit(ast);
+}
+
+auto folder::error() -> std::optional<std::string>
+{
+    return this->error_string;
+}
+
+auto folder::visit(root* node) -> void
+{
+    node->statement_list->accept(this);
+}
+
+auto folder::visit(literal* node) -> void
+{
+    this->folded = node;
+}
+
+auto folder::visit(variable_reference* node) -> void
+{
+    this->folded = node;
+    for (auto it = this->bindings.rbegin(); it != this->bindings.rend(); it++) {
+        if (it->name == node->name) {
+            if (it->value != nullptr) {
+                // Each use gets its own node, the tree stays a tree.
+                this->folded = this->memory->make<literal>(*it->value);
+            }
+            return;
+        }
+    }
+}
+
+auto folder::visit(unary_operation* node) -> void
+{
+    this->fold(node->right);
+    this->folded = node;
+
+    auto value = integer_value(node->right);
+    if (node->op != operation::negation || !value.has_value() || this->has_error()) {
+        return;
+    }
+    auto type = static_cast<literal*>(node->right)->type.type;
+    if (!fits(type, -value.value())) {
+        this->set_overflow(type);
+        return;
+    }
+    this->folded = this->make_literal(type, -value.value());
+}
+
+auto folder::visit(binary_operation* node) -> void
+{
+    this->fold(node->left);
+    this->fold(node->right);
+    this->folded = node;
+
+    auto left = integer_value(node->left);
+    auto right = integer_value(node->right);
+    if (!left.has_value() || !right.has_value() || this->has_error()) {
+        return;
+    }
+    auto type =
+        common_type(static_cast<literal*>(node->left)->type.type, static_cast<literal*>(node->right)->type.type);
+
+    __int128 result = 0;
+    bool overflow = false;
+    switch (node->op) {
+    case operation::addition:
+        overflow = __builtin_add_overflow(left.value(), right.value(), &result);
+        break;
+    case operation::subtraction:
+        overflow = __builtin_sub_overflow(left.value(), right.value(), &result);
+        break;
+    case operation::multiplication:
+        overflow = __builtin_mul_overflow(left.value(), right.value(), &result);
+        break;
+    case operation::division:
+        if (right.value() == 0) {
+            this->error_string = "division by zero in function '" + std::string(this->function_name) + "'";
+            return;
+        }
+        result = left.value() / right.value();
+        break;
+    default:
+        return;
+    }
+
+    if (overflow || !fits(type, result)) {
+        this->set_overflow(type);
+        return;
+    }
+    this->folded = this->make_literal(type, result);
+}
+
+auto folder::visit(compound_statement* node) -> void
+{
+    auto scope = this->bindings.size();
+    for (auto* statement : node->statements) {
+        statement->accept(this);
+    }
+    this->bindings.resize(scope);
+}
+
+auto folder::visit(variable_declaration* node) -> void
+{
+    this->fold(node->expr);
+    // A binding to anything else still hides outer constants of the same name.
+    this->bindings.push_back(binding{node->name, dynamic_cast<literal*>(node->expr)});
+}
+
+auto folder::visit(function_declaration* node) -> void
+{
+    this->function_name = this->symbols->name(node->name);
+    node->statement_list->accept(this);
+}
+
+auto folder::visit(function_parameter*) -> void
+{
+}
+
+auto folder::visit(return_statement* node) -> void
+{
+    this->fold(node->return_value);
+}
+
+auto folder::has_error() -> bool
+{
+    return this->error_string.has_value();
+}
+
+auto folder::set_overflow(basic_type type) -> void
+{
+    this->error_string = "constant expression overflows " + std::string(type_name(type)) + " in function '" +
+                         std::string(this->function_name) + "'";
+}
+
+auto folder::fold(expression*& expr) -> void
+{
+    expr->accept(this);
+    expr = this->folded;
+}
+
+auto folder::make_literal(basic_type type, __int128 value) -> literal*
+{
+    auto* lit = this->memory->make<literal>();
+    lit->type = scalar_type(type);
+    switch (type) {
+    case basic_type::u8:
+        lit->value = static_cast<uint8_t>(value);
+        break;
+    case basic_type::i8:
+        lit->value = static_cast<int8_t>(value);
+        break;
+    case basic_type::u16:
+        lit->value = static_cast<uint16_t>(value);
+        break;
+    case basic_type::i16:
+        lit->value = static_cast<int16_t>(value);
+        break;
+    case basic_type::u32:
+        lit->value = static_cast<uint32_t>(value);
+        break;
+    case basic_type::i32:
+        lit->value = static_cast<int32_t>(value);
+        break;
+    case basic_type::u64:
+        lit->value = static_cast<uint64_t>(value);
+        break;
+    default:
+        lit->value = static_cast<int64_t>(value);
+        break;
+    }
+    return lit;
+}
+
+} // namespace monoa::ast
@@ -0,0 +1,73 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_AST_FOLDER_HPP
+#define MONOA_AST_FOLDER_HPP
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ast/ast.hpp>
+#include <ast/visitor.hpp>
+
+namespace monoa::ast {
+
+// Rewrites the tree in place, replacing every operation on constants with the
+// resulting literal and every use of a let bound to a constant with its value.
+// Division by zero and results that do not fit the operation type are errors.
+class folder : public visitor
+{
+public:
+    folder(root* ast);
+    auto error() -> std::optional<std::string>;
+
+    auto visit(root* node) -> void override;
+    auto visit(literal* node) -> void override;
+    auto visit(variable_reference* node) -> void override;
+    auto visit(unary_operation* node) -> void override;
+    auto visit(binary_operation* node) -> void override;
+    auto visit(compound_statement* node) -> void override;
+    auto visit(variable_declaration* node) -> void override;
+    auto visit(function_declaration* node) -> void override;
+    auto visit(function_parameter* node) -> void override;
+    auto visit(return_statement* node) -> void override;
+
+private:
+    struct binding
+    {
+        support::symbol name;
+        literal* value;
+    };
+
+    arena* memory;
+    const support::interner* symbols;
+    std::optional<std::string> error_string;
+    std::string_view function_name;
+    std::vector<binding> bindings;
+    expression* folded = nullptr;
+
+    auto has_error() -> bool;
+    auto set_overflow(basic_type type) -> void;
+    auto fold(expression*& expr) -> void;
+    auto make_literal(basic_type type, __int128 value) -> literal*;
+};
+
+} // namespace monoa::ast
+
+#endif // MONOA_AST_FOLDER_HPP
@@ -26,14 +26,21 @@ auto printer::print(root* node) -> void
     this->visit(node);
 }
 
+auto printer::print(const flat_tree* tree) -> void
+{
+    this->symbols = tree->symbols;
+    this->print_flat(tree, tree->first[tree->root_index()]);
+}
+
 auto printer::visit(root* node) -> void
 {
+    this->symbols = node->symbols;
     node->statement_list->accept(this);
 }
 
 auto printer::visit(literal* node) -> void
 {
-    switch (node->type->type) {
+    switch (node->type.type) {
     case ast::basic_type::i8:
         this->print_node("lit : " + std::to_string(std::get<int8_t>(node->value)));
         break;
@@ -61,9 +68,17 @@ auto printer::visit(literal* node) -> void
     }
 }
 
+auto printer::visit(variable_reference* node) -> void
+{
+    this->print_node("var_ref : " + std::string(this->symbols->name(node->name)));
+}
+
 auto printer::visit(unary_operation* node) -> void
 {
-    this->print_node("un_op");
+    this->print_node("un_op : " + std::to_string(static_cast<int>(node->op)));
+    this->level++;
+    node->right->accept(this);
+    this->level--;
 }
 
 auto printer::visit(binary_operation* node) -> void
@@ -80,7 +95,7 @@ auto printer::visit(compound_statement* node) -> void
     this->print_node("block");
 
     this->level++;
-    for (auto& s : node->statements) {
+    for (auto* s : node->statements) {
         s->accept(this);
     }
     this->level--;
@@ -88,7 +103,7 @@ auto printer::visit(compound_statement* node) -> void
 
 auto printer::visit(variable_declaration* node) -> void
 {
-    this->print_node("var_delc : " + node->name);
+    this->print_node("var_delc : " + std::string(this->symbols->name(node->name)));
 
     this->level++;
     node->expr->accept(this);
@@ -97,7 +112,7 @@ auto printer::visit(variable_declaration* node) -> void
 
 auto printer::visit(function_declaration* node) -> void
 {
-    this->print_node("fun_delc : " + node->name);
+    this->print_node("fun_delc : " + std::string(this->symbols->name(node->name)));
 
     this->level++;
     node->statement_list->accept(this);
@@ -118,6 +133,90 @@ auto printer::visit(return_statement* node) -> void
     this->level--;
 }
 
+auto printer::print_flat(const flat_tree* tree, flat_tree::index node) -> void
+{
+    auto first = tree->first[node];
+    auto second = tree->second[node];
+    auto value = tree->values[node];
+
+    switch (tree->kinds[node]) {
+    case flat_tree::kind::literal:
+        switch (tree->types[node]) {
+        case ast::basic_type::i8:
+            this->print_node("lit : " + std::to_string(static_cast<int8_t>(value)));
+            break;
+        case ast::basic_type::u8:
+            this->print_node("lit : " + std::to_string(static_cast<uint8_t>(value)));
+            break;
+        case ast::basic_type::i16:
+            this->print_node("lit : " + std::to_string(static_cast<int16_t>(value)));
+            break;
+        case ast::basic_type::u16:
+            this->print_node("lit : " + std::to_string(static_cast<uint16_t>(value)));
+            break;
+        case ast::basic_type::i32:
+            this->print_node("lit : " + std::to_string(static_cast<int32_t>(value)));
+            break;
+        case ast::basic_type::u32:
+            this->print_node("lit : " + std::to_string(static_cast<uint32_t>(value)));
+            break;
+        case ast::basic_type::i64:
+            this->print_node("lit : " + std::to_string(static_cast<int64_t>(value)));
+            break;
+        case ast::basic_type::u64:
+            this->print_node("lit : " + std::to_string(value));
+            break;
+        default:
+            break;
+        }
+        break;
+    case flat_tree::kind::variable_reference:
+        this->print_node("var_ref : " + std::string(this->symbols->name(value)));
+        break;
+    case flat_tree::kind::unary_operation:
+        this->print_node("un_op : " + std::to_string(static_cast<int>(tree->operations[node])));
+        this->level++;
+        this->print_flat(tree, first);
+        this->level--;
+        break;
+    case flat_tree::kind::binary_operation:
+        this->print_node("bi_op : " + std::to_string(static_cast<int>(tree->operations[node])));
+        this->level++;
+        this->print_flat(tree, second);
+        this->print_flat(tree, first);
+        this->level--;
+        break;
+    case flat_tree::kind::compound_statement:
+        this->print_node("block");
+        this->level++;
+        for (auto i = first; i < first + second; i++) {
+            this->print_flat(tree, tree->lists[i]);
+        }
+        this->level--;
+        break;
+    case flat_tree::kind::variable_declaration:
+        this->print_node("var_delc : " + std::string(this->symbols->name(value)));
+        this->level++;
+        this->print_flat(tree, first);
+        this->level--;
+        break;
+    case flat_tree::kind::function_declaration:
+        this->print_node("fun_delc : " + std::string(this->symbols->name(value)));
+        this->level++;
+        this->print_flat(tree, first);
+        this->level--;
+        break;
+    case flat_tree::kind::return_statement:
+        this->print_node("ret_stmt");
+        this->level++;
+        this->print_flat(tree, first);
+        this->level--;
+        break;
+    default:
+        break;
+    }
+}
+
 auto printer::print_node(std::string message) -> void
 {
     std::string line_level = " |";
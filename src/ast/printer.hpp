@@ -19,6 +19,7 @@
 #ifndef MONOA_AST_PRINTER_HPP
 #define MONOA_AST_PRINTER_HPP
 
+#include <ast/flat.hpp>
 #include <ast/visitor.hpp>
 
 namespace monoa::ast {
@@ -27,8 +28,10 @@ class printer : visitor
 {
 public:
     auto print(root* node) -> void;
+    auto print(const flat_tree* tree) -> void;
     auto visit(root* node) -> void override;
     auto visit(literal* node) -> void override;
+    auto visit(variable_reference* node) -> void override;
     auto visit(unary_operation* node) -> void override;
     auto visit(binary_operation* node) -> void override;
     auto visit(compound_statement* node) -> void override;
@@ -39,7 +42,9 @@ public:
 
 private:
     unsigned int level = 0;
+    const support::interner* symbols = nullptr;
     auto print_node(std::string message) -> void;
+    auto print_flat(const flat_tree* tree, flat_tree::index node) -> void;
 };
 
 } // namespace monoa::ast
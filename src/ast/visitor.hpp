@@ -28,6 +28,7 @@ class visitor
 public:
     virtual auto visit(root* node) -> void = 0;
     virtual auto visit(literal* node) -> void = 0;
+    virtual auto visit(variable_reference* node) -> void = 0;
     virtual auto visit(unary_operation* node) -> void = 0;
     virtual auto visit(binary_operation* node) -> void = 0;
     virtual auto visit(compound_statement* node) -> void = 0;
@@ -0,0 +1,351 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <backend/assembly.hpp>
+
+namespace {
+
+using namespace monoa::backend;
+
+const char* register_names[4][16] = {
+    {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+     "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"},
+    {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+     "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"},
+    {"ax", "cx", "dx", "bx", "sp", "bp", "si", "di",
+     "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w"},
+    {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+     "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"},
+};
+
+// Longest formatted record, "    imul r15, qword [rbp - 2147483648], -9223372036854775808\n"
+// and a local label name stay well below it.
+constexpr std::size_t max_record_length = 96;
+
+auto append_number(char*& cursor, std::int64_t value) -> void
+{
+    cursor = std::to_chars(cursor, cursor + 20, value).ptr;
+}
+
+auto append_text(char*& cursor, const char* text) -> void
+{
+    while (*text != '\0') {
+        *cursor++ = *text++;
+    }
+}
+
+auto width_name(std::uint8_t width) -> const char*
+{
+    switch (width) {
+    case 8:
+        return "byte";
+    case 16:
+        return "word";
+    case 32:
+        return "dword";
+    default:
+        return "qword";
+    }
+}
+
+} // namespace
+
+namespace monoa::backend {
+
+auto machine_operand::make_register(std::uint8_t reg, std::uint8_t width) -> machine_operand
+{
+    return machine_operand{kind::reg, reg, width, 0};
+}
+
+auto machine_operand::make_memory(std::uint8_t base, std::int64_t displacement, std::uint8_t width) -> machine_operand
+{
+    return machine_operand{kind::memory, base, width, displacement};
+}
+
+auto machine_operand::make_immediate(std::int64_t value) -> machine_operand
+{
+    return machine_operand{kind::immediate, 0, 64, value};
+}
+
+auto machine_operand::make_label(label_kind label, std::uint32_t index) -> machine_operand
+{
+    return machine_operand{kind::label, static_cast<std::uint8_t>(label), 64, index};
+}
+
+auto machine_operand::is_register() const -> bool
+{
+    return this->kind == kind::reg;
+}
+
+auto machine_operand::is_memory() const -> bool
+{
+    return this->kind == kind::memory;
+}
+
+auto machine_operand::is_immediate() const -> bool
+{
+    return this->kind == kind::immediate;
+}
+
+auto machine_operand::is_label() const -> bool
+{
+    return this->kind == kind::label;
+}
+
+auto machine_operand::label() const -> label_kind
+{
+    return static_cast<label_kind>(this->reg);
+}
+
+auto machine_operand::uses(std::uint8_t reg) const -> bool
+{
+    return (this->is_register() || this->is_memory()) && this->reg == reg;
+}
+
+auto machine_operand::operator==(const machine_operand& other) const -> bool
+{
+    return this->kind == other.kind && this->reg == other.reg && this->width == other.width &&
+           this->value == other.value;
+}
+
+auto machine_operand::operator!=(const machine_operand& other) const -> bool
+{
+    return !(*this == other);
+}
+
+auto machine_record::make_command(mnemonic code, std::initializer_list<machine_operand> operands) -> machine_record
+{
+    machine_record record;
+    record.kind = kind::command;
+    record.code = code;
+    for (const auto& operand : operands) {
+        record.operands[record.operand_count++] = operand;
+    }
+    return record;
+}
+
+auto machine_record::make_label(machine_operand label) -> machine_record
+{
+    machine_record record;
+    record.kind = kind::label;
+    record.operand_count = 1;
+    record.operands[0] = label;
+    return record;
+}
+
+auto machine_record::make_global(std::uint32_t symbol, bool function) -> machine_record
+{
+    machine_record record;
+    record.kind = function ? kind::global_function : kind::global;
+    record.operand_count = 1;
+    record.operands[0] = machine_operand::make_label(label_kind::symbol, symbol);
+    return record;
+}
+
+auto machine_record::is_command(mnemonic code) const -> bool
+{
+    return this->kind == kind::command && this->code == code;
+}
+
+auto assembly::intern(std::string_view name) -> std::uint32_t
+{
+    auto [it, inserted] = this->symbol_ids.emplace(std::string(name), static_cast<std::uint32_t>(this->symbols.size()));
+    if (inserted) {
+        this->symbols.emplace_back(name);
+    }
+    return it->second;
+}
+
+auto assembly::symbol_name(std::uint32_t symbol) const -> const std::string&
+{
+    return this->symbols[symbol];
+}
+
+auto assembly::symbol_count() const -> std::uint32_t
+{
+    return static_cast<std::uint32_t>(this->symbols.size());
+}
+
+auto assembly::render(std::string& out) const -> void
+{
+    // Size for the worst case once, then trim, symbol names are the only
+    // part of unbounded length.
+    std::size_t bound = out.size();
+    for (const auto& record : this->records) {
+        bound += max_record_length;
+        for (std::uint8_t i = 0; i < record.operand_count; i++) {
+            const auto& operand = record.operands[i];
+            if (operand.is_label() && operand.label() == label_kind::symbol) {
+                bound += this->symbols[operand.value].size();
+            }
+        }
+    }
+    auto start = out.size();
+    out.resize(bound);
+    char* cursor = out.data() + start;
+
+    auto append_operand = [this, &cursor](const machine_operand& operand) {
+        switch (operand.kind) {
+        case machine_operand::kind::reg:
+            append_text(cursor, register_name(operand.reg, operand.width));
+            break;
+        case machine_operand::kind::memory:
+            append_text(cursor, width_name(operand.width));
+            append_text(cursor, " [");
+            append_text(cursor, register_name(operand.reg, 64));
+            if (operand.value != 0) {
+                append_text(cursor, operand.value < 0 ? " - " : " + ");
+                append_number(cursor, operand.value < 0 ? -operand.value : operand.value);
+            }
+            *cursor++ = ']';
+            break;
+        case machine_operand::kind::immediate:
+            append_number(cursor, operand.value);
+            break;
+        case machine_operand::kind::label:
+            switch (operand.label()) {
+            case label_kind::symbol: {
+                const auto& name = this->symbols[operand.value];
+                cursor = std::copy(name.begin(), name.end(), cursor);
+                break;
+            }
+            case label_kind::block:
+                append_text(cursor, ".b");
+                append_number(cursor, operand.value);
+                break;
+            case label_kind::edge:
+                append_text(cursor, ".e");
+                append_number(cursor, operand.value);
+                break;
+            case label_kind::exit:
+                append_text(cursor, ".return");
+                break;
+            }
+            break;
+        case machine_operand::kind::none:
+            break;
+        }
+    };
+
+    for (const auto& record : this->records) {
+        switch (record.kind) {
+        case machine_record::kind::global:
+        case machine_record::kind::global_function:
+            append_text(cursor, "global ");
+            append_operand(record.operands[0]);
+            if (record.kind == machine_record::kind::global_function) {
+                append_text(cursor, ":function");
+            }
+            break;
+        case machine_record::kind::label:
+            append_operand(record.operands[0]);
+            *cursor++ = ':';
+            break;
+        case machine_record::kind::command:
+            append_text(cursor, "    ");
+            append_text(cursor, mnemonic_name(record.code));
+            for (std::uint8_t i = 0; i < record.operand_count; i++) {
+                append_text(cursor, i == 0 ? " " : ", ");
+                append_operand(record.operands[i]);
+            }
+            break;
+        }
+        *cursor++ = '\n';
+    }
+    out.resize(static_cast<std::size_t>(cursor - out.data()));
+}
+
+auto mnemonic_name(mnemonic code) -> const char*
+{
+    switch (code) {
+    case mnemonic::mov:
+        return "mov";
+    case mnemonic::movsx:
+        return "movsx";
+    case mnemonic::movsxd:
+        return "movsxd";
+    case mnemonic::movzx:
+        return "movzx";
+    case mnemonic::add:
+        return "add";
+    case mnemonic::sub:
+        return "sub";
+    case mnemonic::imul:
+        return "imul";
+    case mnemonic::div:
+        return "div";
+    case mnemonic::idiv:
+        return "idiv";
+    case mnemonic::cqo:
+        return "cqo";
+    case mnemonic::xor_:
+        return "xor";
+    case mnemonic::cmp:
+        return "cmp";
+    case mnemonic::push:
+        return "push";
+    case mnemonic::pop:
+        return "pop";
+    case mnemonic::jmp:
+        return "jmp";
+    case mnemonic::je:
+        return "je";
+    case mnemonic::jne:
+        return "jne";
+    case mnemonic::call:
+        return "call";
+    case mnemonic::ret:
+        return "ret";
+    case mnemonic::syscall:
+        return "syscall";
+    }
+    return "";
+}
+
+auto register_name(std::uint8_t reg, std::uint8_t width) -> const char*
+{
+    switch (width) {
+    case 8:
+        return register_names[3][reg];
+    case 16:
+        return register_names[2][reg];
+    case 32:
+        return register_names[1][reg];
+    default:
+        return register_names[0][reg];
+    }
+}
+
+auto local_label_name(label_kind kind, std::uint32_t index) -> std::string
+{
+    switch (kind) {
+    case label_kind::block:
+        return ".b" + std::to_string(index);
+    case label_kind::edge:
+        return ".e" + std::to_string(index);
+    case label_kind::exit:
+        return ".return";
+    case label_kind::symbol:
+        break;
+    }
+    return "";
+}
+
+} // namespace monoa::backend
@@ -0,0 +1,166 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_BACKEND_ASSEMBLY_HPP
+#define MONOA_BACKEND_ASSEMBLY_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace monoa::backend {
+
+enum class mnemonic : std::uint8_t
+{
+    mov,
+    movsx,
+    movsxd,
+    movzx,
+    add,
+    sub,
+    imul,
+    div,
+    idiv,
+    cqo,
+    xor_,
+    cmp,
+    push,
+    pop,
+    jmp,
+    je,
+    jne,
+    call,
+    ret,
+    syscall,
+};
+
+// Hardware register numbers, as they go into ModRM and REX.
+enum machine_register : std::uint8_t
+{
+    rax,
+    rcx,
+    rdx,
+    rbx,
+    rsp,
+    rbp,
+    rsi,
+    rdi,
+    r8,
+    r9,
+    r10,
+    r11,
+    r12,
+    r13,
+    r14,
+    r15,
+};
+
+// Labels other than symbols are local to the last symbol defined before them.
+enum class label_kind : std::uint8_t
+{
+    symbol,
+    block,
+    edge,
+    exit,
+};
+
+struct machine_operand
+{
+    enum class kind : std::uint8_t
+    {
+        none,
+        reg,
+        memory,
+        immediate,
+        label,
+    };
+
+    kind kind = kind::none;
+    // Register, base register of a memory operand, or label_kind of a label.
+    std::uint8_t reg = 0;
+    // Width in bits of a register or memory operand.
+    std::uint8_t width = 64;
+    // Immediate, displacement of a memory operand, or index of a label.
+    std::int64_t value = 0;
+
+    static auto make_register(std::uint8_t reg, std::uint8_t width = 64) -> machine_operand;
+    static auto make_memory(std::uint8_t base, std::int64_t displacement, std::uint8_t width = 64) -> machine_operand;
+    static auto make_immediate(std::int64_t value) -> machine_operand;
+    static auto make_label(label_kind kind, std::uint32_t index) -> machine_operand;
+    auto is_register() const -> bool;
+    auto is_memory() const -> bool;
+    auto is_immediate() const -> bool;
+    auto is_label() const -> bool;
+    auto label() const -> label_kind;
+    // Whether the operand reads or writes any part of register `reg`.
+    auto uses(std::uint8_t reg) const -> bool;
+    auto operator==(const machine_operand& other) const -> bool;
+    auto operator!=(const machine_operand& other) const -> bool;
+};
+
+// One line of assembly in a fixed size record, a command with up to three
+// operands, a label definition or a global declaration of a symbol.
+struct machine_record
+{
+    enum class kind : std::uint8_t
+    {
+        command,
+        label,
+        global,
+        global_function,
+    };
+
+    kind kind = kind::command;
+    mnemonic code = mnemonic::ret;
+    std::uint8_t operand_count = 0;
+    machine_operand operands[3];
+
+    static auto make_command(mnemonic code, std::initializer_list<machine_operand> operands = {}) -> machine_record;
+    static auto make_label(machine_operand label) -> machine_record;
+    static auto make_global(std::uint32_t symbol, bool function) -> machine_record;
+    auto is_command(mnemonic code) const -> bool;
+};
+
+// Records of the text section along with the names of its symbols, which
+// are the only strings kept before formatting.
+class assembly
+{
+public:
+    auto intern(std::string_view name) -> std::uint32_t;
+    auto symbol_name(std::uint32_t symbol) const -> const std::string&;
+    auto symbol_count() const -> std::uint32_t;
+    // Formats every record as nasm text in a single pass.
+    auto render(std::string& out) const -> void;
+
+    std::vector<machine_record> records;
+
+private:
+    std::vector<std::string> symbols;
+    std::unordered_map<std::string, std::uint32_t> symbol_ids;
+};
+
+auto mnemonic_name(mnemonic code) -> const char*;
+auto register_name(std::uint8_t reg, std::uint8_t width) -> const char*;
+// Name of a local label, without the symbol it is local to.
+auto local_label_name(label_kind kind, std::uint32_t index) -> std::string;
+
+} // namespace monoa::backend
+
+#endif // MONOA_BACKEND_ASSEMBLY_HPP
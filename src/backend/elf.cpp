@@ -0,0 +1,277 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <backend/elf.hpp>
+
+namespace {
+
+using monoa::backend::symbol;
+
+constexpr std::uint64_t base_address = 0x400000;
+constexpr std::uint64_t page_size = 0x1000;
+constexpr std::uint64_t header_size = 64;
+constexpr std::uint64_t program_header_size = 56;
+constexpr std::uint64_t section_header_size = 64;
+constexpr std::uint64_t symbol_size = 24;
+
+constexpr std::uint32_t pt_load = 1;
+constexpr std::uint32_t pt_gnu_stack = 0x6474e551;
+constexpr std::uint32_t pf_x = 1;
+constexpr std::uint32_t pf_w = 2;
+constexpr std::uint32_t pf_r = 4;
+
+constexpr std::uint32_t sht_progbits = 1;
+constexpr std::uint32_t sht_symtab = 2;
+constexpr std::uint32_t sht_strtab = 3;
+constexpr std::uint64_t shf_write = 1;
+constexpr std::uint64_t shf_alloc = 2;
+constexpr std::uint64_t shf_execinstr = 4;
+
+enum section_index : std::uint16_t
+{
+    section_null,
+    section_text,
+    section_data,
+    section_symtab,
+    section_strtab,
+    section_shstrtab,
+    section_count,
+};
+
+auto align(std::uint64_t value, std::uint64_t alignment) -> std::uint64_t
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+auto put(std::string& out, std::uint64_t value, unsigned int bytes) -> void
+{
+    for (unsigned int i = 0; i < bytes; i++) {
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+auto pad(std::string& out, std::uint64_t offset) -> void
+{
+    out.resize(offset, '\0');
+}
+
+// Appends a name to a string table and returns its offset.
+auto add_name(std::string& table, std::string_view name) -> std::uint32_t
+{
+    auto offset = static_cast<std::uint32_t>(table.size());
+    table += name;
+    table += '\0';
+    return offset;
+}
+
+struct program_header
+{
+    std::uint32_t type;
+    std::uint32_t flags;
+    std::uint64_t offset;
+    std::uint64_t address;
+    std::uint64_t size;
+    std::uint64_t alignment;
+};
+
+struct section_header
+{
+    std::uint32_t name;
+    std::uint32_t type;
+    std::uint64_t flags;
+    std::uint64_t address;
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint32_t link;
+    std::uint32_t info;
+    std::uint64_t alignment;
+    std::uint64_t entry_size;
+};
+
+} // namespace
+
+namespace monoa::backend {
+
+elf_executable::elf_executable(std::string_view text,
+                               std::string_view data,
+                               const std::vector<symbol>* symbols,
+                               std::string_view entry)
+{
+    this->write(text, data, *symbols, entry);
+}
+
+auto elf_executable::result() -> std::string
+{
+    return this->image;
+}
+
+auto elf_executable::error() -> std::optional<std::string>
+{
+    return this->error_string;
+}
+
+auto elf_executable::write(std::string_view text,
+                           std::string_view data,
+                           const std::vector<symbol>& symbols,
+                           std::string_view entry) -> void
+{
+    const symbol* entry_symbol = nullptr;
+    for (const auto& candidate : symbols) {
+        if (candidate.name == entry) {
+            entry_symbol = &candidate;
+        }
+    }
+    if (entry_symbol == nullptr) {
+        this->error_string = "undefined entry point '" + std::string(entry) + "'";
+        return;
+    }
+
+    // The first segment maps the headers along with the text, data gets a
+    // page of its own so that its protection can differ.
+    std::vector<program_header> segments;
+    std::uint64_t segment_count = data.empty() ? 2 : 3;
+    std::uint64_t text_offset = align(header_size + program_header_size * segment_count, 16);
+    std::uint64_t text_end = text_offset + text.size();
+    std::uint64_t data_offset = data.empty() ? align(text_end, 16) : align(text_end, page_size);
+    segments.push_back({pt_load, pf_r | pf_x, 0, base_address, text_end, page_size});
+    if (!data.empty()) {
+        segments.push_back({pt_load, pf_r | pf_w, data_offset, base_address + data_offset, data.size(), page_size});
+    }
+    segments.push_back({pt_gnu_stack, pf_r | pf_w, 0, 0, 0, 16});
+
+    // Local symbols have to come before global ones.
+    std::string strtab(1, '\0');
+    std::string symtab(symbol_size, '\0');
+    std::uint32_t first_global = 1;
+    for (bool global : {false, true}) {
+        for (const auto& entry : symbols) {
+            if (entry.global != global) {
+                continue;
+            }
+            put(symtab, add_name(strtab, entry.name), 4);
+            put(symtab, (global ? 1 << 4 : 0) | (entry.function ? 2 : 0), 1);
+            put(symtab, 0, 1);
+            put(symtab, section_text, 2);
+            put(symtab, base_address + text_offset + entry.offset, 8);
+            put(symtab, entry.size, 8);
+            first_global += global ? 0 : 1;
+        }
+    }
+
+    std::string shstrtab(1, '\0');
+    std::uint64_t symtab_offset = align(data_offset + data.size(), 8);
+    std::uint64_t strtab_offset = symtab_offset + symtab.size();
+    std::uint64_t shstrtab_offset = strtab_offset + strtab.size();
+
+    section_header sections[section_count] = {};
+    sections[section_text] = {add_name(shstrtab, ".text"),
+                              sht_progbits,
+                              shf_alloc | shf_execinstr,
+                              base_address + text_offset,
+                              text_offset,
+                              text.size(),
+                              0,
+                              0,
+                              16,
+                              0};
+    sections[section_data] = {add_name(shstrtab, ".data"),
+                              sht_progbits,
+                              shf_alloc | shf_write,
+                              base_address + data_offset,
+                              data_offset,
+                              data.size(),
+                              0,
+                              0,
+                              4,
+                              0};
+    sections[section_symtab] = {add_name(shstrtab, ".symtab"),
+                                sht_symtab,
+                                0,
+                                0,
+                                symtab_offset,
+                                symtab.size(),
+                                section_strtab,
+                                first_global,
+                                8,
+                                symbol_size};
+    sections[section_strtab] = {
+        add_name(shstrtab, ".strtab"), sht_strtab, 0, 0, strtab_offset, strtab.size(), 0, 0, 1, 0};
+    // Braced initializers evaluate in order, the size includes the name just added.
+    sections[section_shstrtab] = {
+        add_name(shstrtab, ".shstrtab"), sht_strtab, 0, 0, shstrtab_offset, shstrtab.size(), 0, 0, 1, 0};
+    std::uint64_t section_offset = align(shstrtab_offset + shstrtab.size(), 8);
+
+    auto& out = this->image;
+    out.reserve(section_offset + section_header_size * section_count);
+    out += "\x7f"
+           "ELF";
+    put(out, 2, 1); // 64 bit
+    put(out, 1, 1); // little endian
+    put(out, 1, 1); // version
+    pad(out, 16);
+    put(out, 2, 2);    // executable
+    put(out, 0x3e, 2); // x86-64
+    put(out, 1, 4);
+    put(out, base_address + text_offset + entry_symbol->offset, 8);
+    put(out, header_size, 8);
+    put(out, section_offset, 8);
+    put(out, 0, 4);
+    put(out, header_size, 2);
+    put(out, program_header_size, 2);
+    put(out, segments.size(), 2);
+    put(out, section_header_size, 2);
+    put(out, section_count, 2);
+    put(out, section_shstrtab, 2);
+
+    for (const auto& segment : segments) {
+        put(out, segment.type, 4);
+        put(out, segment.flags, 4);
+        put(out, segment.offset, 8);
+        put(out, segment.address, 8);
+        put(out, segment.address, 8);
+        put(out, segment.size, 8);
+        put(out, segment.size, 8);
+        put(out, segment.alignment, 8);
+    }
+
+    pad(out, text_offset);
+    out += text;
+    pad(out, data_offset);
+    out += data;
+    pad(out, symtab_offset);
+    out += symtab;
+    out += strtab;
+    out += shstrtab;
+    pad(out, section_offset);
+
+    for (const auto& section : sections) {
+        put(out, section.name, 4);
+        put(out, section.type, 4);
+        put(out, section.flags, 8);
+        put(out, section.address, 8);
+        put(out, section.offset, 8);
+        put(out, section.size, 8);
+        put(out, section.link, 4);
+        put(out, section.info, 4);
+        put(out, section.alignment, 8);
+        put(out, section.entry_size, 8);
+    }
+}
+
+} // namespace monoa::backend
@@ -0,0 +1,55 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_BACKEND_ELF_HPP
+#define MONOA_BACKEND_ELF_HPP
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <backend/encoder.hpp>
+
+namespace monoa::backend {
+
+// Static x86-64 ELF executable with .text, .data and a symbol table, laid out
+// so that it needs neither an assembler nor a linker. Text is mapped read and
+// execute, data read and write, and the stack is not executable.
+class elf_executable
+{
+public:
+    elf_executable(std::string_view text,
+                   std::string_view data,
+                   const std::vector<symbol>* symbols,
+                   std::string_view entry);
+    auto result() -> std::string;
+    auto error() -> std::optional<std::string>;
+
+private:
+    std::optional<std::string> error_string;
+    std::string image;
+
+    auto write(std::string_view text,
+               std::string_view data,
+               const std::vector<symbol>& symbols,
+               std::string_view entry) -> void;
+};
+
+} // namespace monoa::backend
+
+#endif // MONOA_BACKEND_ELF_HPP
@@ -0,0 +1,472 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <backend/encoder.hpp>
+
+namespace {
+
+using namespace monoa::backend;
+
+// The extension is both the /digit of the immediate forms and the row of the
+// register forms in the opcode map.
+auto alu_extension(mnemonic code) -> int
+{
+    switch (code) {
+    case mnemonic::add:
+        return 0;
+    case mnemonic::sub:
+        return 5;
+    case mnemonic::xor_:
+        return 6;
+    case mnemonic::cmp:
+        return 7;
+    default:
+        return -1;
+    }
+}
+
+// Condition code of a conditional jump, or 0xff for an unconditional one.
+auto jump_condition(mnemonic code) -> std::uint8_t
+{
+    return code == mnemonic::je ? 0x4 : code == mnemonic::jne ? 0x5 : 0xff;
+}
+
+// Labels are keyed by the symbol they are local to, their kind and index.
+auto label_key(std::uint32_t scope, const machine_operand& label) -> std::uint64_t
+{
+    if (label.label() == label_kind::symbol) {
+        return static_cast<std::uint64_t>(label.value) << 34;
+    }
+    return (static_cast<std::uint64_t>(scope) << 34) | (static_cast<std::uint64_t>(label.label()) << 32) |
+           static_cast<std::uint32_t>(label.value);
+}
+
+auto fits_8(std::int64_t value) -> bool
+{
+    return value >= -128 && value <= 127;
+}
+
+auto fits_32(std::int64_t value) -> bool
+{
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+auto put(std::string& out, std::uint64_t value, unsigned int bytes) -> void
+{
+    for (unsigned int i = 0; i < bytes; i++) {
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+// REX prefix, opcode and ModRM (plus SIB and displacement) of an instruction
+// whose r/m operand is `rm` and whose reg field holds `reg_field`.
+auto emit_op(std::string& out,
+             bool wide,
+             std::initializer_list<std::uint8_t> opcode,
+             unsigned int reg_field,
+             const machine_operand& rm) -> void
+{
+    std::uint8_t rex = 0x40 | (wide ? 0x08 : 0) | (((reg_field >> 3) & 1) << 2) | ((rm.reg >> 3) & 1);
+    // spl, bpl, sil and dil only exist with a REX prefix.
+    bool needs_rex = rm.is_register() && rm.width == 8 && rm.reg >= 4 && rm.reg < 8;
+    if (rex != 0x40 || needs_rex) {
+        out += static_cast<char>(rex);
+    }
+    for (auto byte : opcode) {
+        out += static_cast<char>(byte);
+    }
+
+    std::uint8_t reg_bits = (reg_field & 7) << 3;
+    if (rm.is_register()) {
+        out += static_cast<char>(0xc0 | reg_bits | (rm.reg & 7));
+        return;
+    }
+
+    // rbp and r13 as a base always need a displacement, mod 00 means rip
+    // relative for them. rsp and r12 need a SIB byte.
+    std::uint8_t mod;
+    if (rm.value == 0 && (rm.reg & 7) != 5) {
+        mod = 0;
+    } else if (fits_8(rm.value)) {
+        mod = 1;
+    } else {
+        mod = 2;
+    }
+    out += static_cast<char>((mod << 6) | reg_bits | (rm.reg & 7));
+    if ((rm.reg & 7) == 4) {
+        out += static_cast<char>(0x24);
+    }
+    if (mod == 1) {
+        put(out, static_cast<std::uint64_t>(rm.value), 1);
+    } else if (mod == 2) {
+        put(out, static_cast<std::uint64_t>(rm.value), 4);
+    }
+}
+
+} // namespace
+
+namespace monoa::backend {
+
+encoder::encoder(const assembly* program) : program(program)
+{
+    this->encode();
+}
+
+auto encoder::text() -> const std::string&
+{
+    return this->code;
+}
+
+auto encoder::symbols() -> const std::vector<symbol>&
+{
+    return this->symbol_table;
+}
+
+auto encoder::error() -> std::optional<std::string>
+{
+    return this->error_string;
+}
+
+auto encoder::encode() -> void
+{
+    // Whether each symbol is declared global, and as a function.
+    std::vector<enum machine_record::kind> globals(this->program->symbol_count(), machine_record::kind::command);
+    std::uint32_t scope = 0;
+
+    this->items.reserve(this->program->records.size());
+    for (const auto& record : this->program->records) {
+        switch (record.kind) {
+        case machine_record::kind::global:
+        case machine_record::kind::global_function:
+            globals[record.operands[0].value] = record.kind;
+            break;
+        case machine_record::kind::label: {
+            const auto& name = record.operands[0];
+            // Local labels belong to the last symbol defined.
+            if (name.label() == label_kind::symbol) {
+                scope = static_cast<std::uint32_t>(name.value);
+            }
+            auto key = label_key(scope, name);
+            if (!this->label_items.emplace(key, this->items.size()).second) {
+                this->error_string = "label '" + this->label_name(key) + "' defined twice";
+                return;
+            }
+            this->labels.push_back(label{scope, name, this->items.size()});
+            break;
+        }
+        case machine_record::kind::command: {
+            item next;
+            auto code = record.code;
+            if (code == mnemonic::jmp || code == mnemonic::je || code == mnemonic::jne || code == mnemonic::call) {
+                if (record.operand_count != 1 || !record.operands[0].is_label()) {
+                    this->error_string = std::string(mnemonic_name(code)) + " takes a single label";
+                    return;
+                }
+                next.branch = true;
+                next.is_call = code == mnemonic::call;
+                next.condition = jump_condition(code);
+                next.target = label_key(scope, record.operands[0]);
+            } else if (!this->encode_command(record, next.bytes)) {
+                return;
+            }
+            this->items.push_back(std::move(next));
+            break;
+        }
+        }
+    }
+
+    this->layout();
+    if (this->error_string.has_value()) {
+        return;
+    }
+
+    this->symbol_table.reserve(this->labels.size());
+    for (std::size_t i = 0; i < this->labels.size(); i++) {
+        const auto& label = this->labels[i];
+        const auto& scope_name = this->program->symbol_name(label.scope);
+        symbol entry{label.name.label() == label_kind::symbol
+                         ? scope_name
+                         : scope_name + local_label_name(label.name.label(), label.name.value),
+                     this->label_offset(label.item)};
+        if (label.name.label() == label_kind::symbol) {
+            auto global = globals[label.scope];
+            entry.global = global != machine_record::kind::command;
+            entry.function = global == machine_record::kind::global_function;
+        }
+        if (entry.function) {
+            // A function runs up to the next label that is not local to it.
+            std::uint64_t end = this->code.size();
+            for (auto j = i + 1; j < this->labels.size(); j++) {
+                if (this->labels[j].name.label() == label_kind::symbol) {
+                    end = this->label_offset(this->labels[j].item);
+                    break;
+                }
+            }
+            entry.size = end - entry.offset;
+        }
+        this->symbol_table.push_back(std::move(entry));
+    }
+}
+
+auto encoder::label_name(std::uint64_t key) -> std::string
+{
+    auto scope = static_cast<std::uint32_t>(key >> 34);
+    auto kind = static_cast<label_kind>((key >> 32) & 3);
+    const auto& name = this->program->symbol_name(scope);
+    return kind == label_kind::symbol ? name : name + local_label_name(kind, static_cast<std::uint32_t>(key));
+}
+
+auto encoder::encode_command(const machine_record& record, std::string& out) -> bool
+{
+    const auto* operands = record.operands;
+    using kind = enum machine_operand::kind;
+    auto code = record.code;
+    auto shape = [&record](std::initializer_list<kind> kinds) {
+        if (record.operand_count != kinds.size()) {
+            return false;
+        }
+        std::size_t i = 0;
+        for (auto expected : kinds) {
+            if (record.operands[i++].kind != expected) {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto unsupported = [this, &record]() {
+        assembly single;
+        single.records.push_back(record);
+        std::string text;
+        single.render(text);
+        this->error_string = "cannot encode '" + text.substr(4, text.size() - 5) + "'";
+        return false;
+    };
+
+    if (code == mnemonic::ret && shape({})) {
+        out += '\xc3';
+        return true;
+    }
+    if (code == mnemonic::cqo && shape({})) {
+        out += "\x48\x99";
+        return true;
+    }
+    if (code == mnemonic::syscall && shape({})) {
+        out += "\x0f\x05";
+        return true;
+    }
+
+    if ((code == mnemonic::push || code == mnemonic::pop) && shape({kind::reg}) && operands[0].width == 64) {
+        if (operands[0].reg >= 8) {
+            out += '\x41';
+        }
+        out += static_cast<char>((code == mnemonic::push ? 0x50 : 0x58) + (operands[0].reg & 7));
+        return true;
+    }
+
+    if (code == mnemonic::mov) {
+        const auto& destination = operands[0];
+        const auto& source = operands[1];
+        bool wide = destination.width == 64;
+        if (shape({kind::reg, kind::reg}) && destination.width == source.width && destination.width >= 32) {
+            emit_op(out, wide, {0x89}, source.reg, destination);
+            return true;
+        }
+        if (shape({kind::reg, kind::immediate}) && destination.width >= 32) {
+            auto value = source.value;
+            // Like nasm, a value that zero extends from 32 bits takes the short
+            // form, which clears the upper half.
+            if (!wide || (value >= 0 && value <= UINT32_MAX)) {
+                if (destination.reg >= 8) {
+                    out += '\x41';
+                }
+                out += static_cast<char>(0xb8 + (destination.reg & 7));
+                put(out, static_cast<std::uint64_t>(value), 4);
+            } else if (fits_32(value)) {
+                emit_op(out, true, {0xc7}, 0, destination);
+                put(out, static_cast<std::uint64_t>(value), 4);
+            } else {
+                out += static_cast<char>(0x48 | (destination.reg >> 3));
+                out += static_cast<char>(0xb8 + (destination.reg & 7));
+                put(out, static_cast<std::uint64_t>(value), 8);
+            }
+            return true;
+        }
+        if (shape({kind::reg, kind::memory}) && destination.width >= 32) {
+            emit_op(out, wide, {0x8b}, destination.reg, source);
+            return true;
+        }
+        if (shape({kind::memory, kind::reg}) && source.width >= 32) {
+            emit_op(out, source.width == 64, {0x89}, source.reg, destination);
+            return true;
+        }
+        if (shape({kind::memory, kind::immediate}) && destination.width >= 32 && fits_32(source.value)) {
+            emit_op(out, wide, {0xc7}, 0, destination);
+            put(out, static_cast<std::uint64_t>(source.value), 4);
+            return true;
+        }
+        return unsupported();
+    }
+
+    if (auto extension = alu_extension(code); extension >= 0 && record.operand_count == 2 && operands[0].width >= 32) {
+        const auto& destination = operands[0];
+        const auto& source = operands[1];
+        bool wide = destination.width == 64;
+        std::uint8_t row = extension << 3;
+        if ((shape({kind::reg, kind::reg}) || shape({kind::memory, kind::reg})) && source.width == destination.width) {
+            emit_op(out, wide, {static_cast<std::uint8_t>(row + 1)}, source.reg, destination);
+            return true;
+        }
+        if (shape({kind::reg, kind::memory})) {
+            emit_op(out, wide, {static_cast<std::uint8_t>(row + 3)}, destination.reg, source);
+            return true;
+        }
+        if ((shape({kind::reg, kind::immediate}) || shape({kind::memory, kind::immediate})) && fits_32(source.value)) {
+            if (fits_8(source.value)) {
+                emit_op(out, wide, {0x83}, extension, destination);
+                put(out, static_cast<std::uint64_t>(source.value), 1);
+            } else if (destination.is_register() && destination.reg == rax) {
+                if (wide) {
+                    out += '\x48';
+                }
+                out += static_cast<char>(row + 5);
+                put(out, static_cast<std::uint64_t>(source.value), 4);
+            } else {
+                emit_op(out, wide, {0x81}, extension, destination);
+                put(out, static_cast<std::uint64_t>(source.value), 4);
+            }
+            return true;
+        }
+        return unsupported();
+    }
+
+    if (code == mnemonic::imul && record.operand_count > 0 && operands[0].is_register() && operands[0].width >= 32) {
+        const auto& destination = operands[0];
+        bool wide = destination.width == 64;
+        if (shape({kind::reg, kind::reg}) || shape({kind::reg, kind::memory})) {
+            emit_op(out, wide, {0x0f, 0xaf}, destination.reg, operands[1]);
+            return true;
+        }
+        if ((shape({kind::reg, kind::reg, kind::immediate}) || shape({kind::reg, kind::memory, kind::immediate})) &&
+            fits_32(operands[2].value)) {
+            bool short_immediate = fits_8(operands[2].value);
+            emit_op(out, wide, {static_cast<std::uint8_t>(short_immediate ? 0x6b : 0x69)}, destination.reg, operands[1]);
+            put(out, static_cast<std::uint64_t>(operands[2].value), short_immediate ? 1 : 4);
+            return true;
+        }
+        return unsupported();
+    }
+
+    if ((code == mnemonic::div || code == mnemonic::idiv) && (shape({kind::reg}) || shape({kind::memory})) &&
+        operands[0].width >= 32) {
+        std::uint8_t extension = code == mnemonic::div ? 6 : 7;
+        emit_op(out, operands[0].width == 64, {0xf7}, extension, operands[0]);
+        return true;
+    }
+
+    if (code == mnemonic::movsxd && shape({kind::reg, kind::reg}) && operands[0].width == 64 && operands[1].width == 32) {
+        emit_op(out, true, {0x63}, operands[0].reg, operands[1]);
+        return true;
+    }
+
+    if ((code == mnemonic::movsx || code == mnemonic::movzx) && shape({kind::reg, kind::reg}) && operands[0].width >= 32 &&
+        operands[1].width <= 16) {
+        std::uint8_t opcode = (code == mnemonic::movsx ? 0xbe : 0xb6) + (operands[1].width == 16 ? 1 : 0);
+        emit_op(out, operands[0].width == 64, {0x0f, opcode}, operands[0].reg, operands[1]);
+        return true;
+    }
+
+    return unsupported();
+}
+
+// Branches start short and only grow, so repeating until nothing changes
+// terminates with every displacement fitting its form.
+auto encoder::layout() -> void
+{
+    auto size = [](const item& item) -> std::uint64_t {
+        if (!item.branch) {
+            return item.bytes.size();
+        }
+        if (item.is_call) {
+            return 5;
+        }
+        if (!item.is_long) {
+            return 2;
+        }
+        return item.condition == 0xff ? 5 : 6;
+    };
+
+    for (auto& item : this->items) {
+        if (item.branch && this->label_items.find(item.target) == this->label_items.end()) {
+            this->error_string = "undefined label '" + this->label_name(item.target) + "'";
+            return;
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        std::uint64_t offset = 0;
+        for (auto& item : this->items) {
+            item.offset = offset;
+            offset += size(item);
+        }
+        this->code_size = offset;
+        for (auto& item : this->items) {
+            if (!item.branch || item.is_call || item.is_long) {
+                continue;
+            }
+            auto target = static_cast<std::int64_t>(this->label_offset(this->label_items[item.target]));
+            auto displacement = target - static_cast<std::int64_t>(item.offset + 2);
+            if (!fits_8(displacement)) {
+                item.is_long = true;
+                changed = true;
+            }
+        }
+    }
+
+    this->code.reserve(this->code_size);
+    for (const auto& item : this->items) {
+        if (!item.branch) {
+            this->code += item.bytes;
+            continue;
+        }
+        auto target = static_cast<std::int64_t>(this->label_offset(this->label_items[item.target]));
+        auto displacement = static_cast<std::uint64_t>(target - static_cast<std::int64_t>(item.offset + size(item)));
+        if (item.is_call) {
+            this->code += '\xe8';
+            put(this->code, displacement, 4);
+        } else if (item.condition == 0xff) {
+            this->code += item.is_long ? '\xe9' : '\xeb';
+            put(this->code, displacement, item.is_long ? 4 : 1);
+        } else if (item.is_long) {
+            this->code += '\x0f';
+            this->code += static_cast<char>(0x80 + item.condition);
+            put(this->code, displacement, 4);
+        } else {
+            this->code += static_cast<char>(0x70 + item.condition);
+            put(this->code, displacement, 1);
+        }
+    }
+}
+
+auto encoder::label_offset(std::size_t item) -> std::uint64_t
+{
+    return item < this->items.size() ? this->items[item].offset : this->code_size;
+}
+
+} // namespace monoa::backend
@@ -0,0 +1,94 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_BACKEND_ENCODER_HPP
+#define MONOA_BACKEND_ENCODER_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <backend/assembly.hpp>
+
+namespace monoa::backend {
+
+struct symbol
+{
+    std::string name;
+    // Offset from the start of the text section.
+    std::uint64_t offset = 0;
+    std::uint64_t size = 0;
+    bool global = false;
+    bool function = false;
+};
+
+// Turns assembly records into x86-64 machine code, choosing the same encodings
+// as nasm does by default: the shortest immediate and jump forms, and 32 bit
+// moves for immediates that zero extend. Every reference is pc relative so
+// the code does not depend on where it gets loaded.
+class encoder
+{
+public:
+    encoder(const assembly* program);
+    auto text() -> const std::string&;
+    auto symbols() -> const std::vector<symbol>&;
+    auto error() -> std::optional<std::string>;
+
+private:
+    // A command with its fixed bytes, or a branch resolved once labels have
+    // their final offsets.
+    struct item
+    {
+        std::string bytes;
+        bool branch = false;
+        std::uint8_t condition = 0;
+        bool is_call = false;
+        bool is_long = false;
+        std::uint64_t target = 0;
+        std::uint64_t offset = 0;
+    };
+
+    // A label definition, with the index of the item it precedes.
+    struct label
+    {
+        std::uint32_t scope;
+        machine_operand name;
+        std::size_t item;
+    };
+
+    std::optional<std::string> error_string;
+    std::string code;
+    std::uint64_t code_size = 0;
+    std::vector<symbol> symbol_table;
+    std::vector<item> items;
+    const assembly* program;
+    // Labels in order of definition, and by key for branches to find.
+    std::vector<label> labels;
+    std::unordered_map<std::uint64_t, std::size_t> label_items;
+
+    auto encode() -> void;
+    auto encode_command(const machine_record& record, std::string& out) -> bool;
+    auto label_name(std::uint64_t key) -> std::string;
+    auto layout() -> void;
+    auto label_offset(std::size_t item) -> std::uint64_t;
+};
+
+} // namespace monoa::backend
+
+#endif // MONOA_BACKEND_ENCODER_HPP
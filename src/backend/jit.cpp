@@ -0,0 +1,111 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <backend/jit.hpp>
+#include <backend/x86.hpp>
+
+namespace monoa::backend {
+
+jit::jit(const std::string& text, const std::vector<symbol>* symbols) : symbols(*symbols)
+{
+    this->load(text);
+}
+
+jit::~jit()
+{
+    if (this->memory != nullptr) {
+        ::munmap(this->memory, this->length);
+    }
+}
+
+auto jit::error() -> std::optional<std::string>
+{
+    return this->error_string;
+}
+
+auto jit::address(std::string_view name) -> const void*
+{
+    if (this->memory == nullptr) {
+        return nullptr;
+    }
+    for (const auto& entry : this->symbols) {
+        if (entry.name == name) {
+            return static_cast<const char*>(this->memory) + entry.offset;
+        }
+    }
+    return nullptr;
+}
+
+auto jit::entry(std::string_view name) -> native_function
+{
+    const void* function = this->address(name);
+    if (function == nullptr) {
+        return nullptr;
+    }
+    return reinterpret_cast<native_function>(const_cast<void*>(function));
+}
+
+auto jit::call(std::string_view name) -> std::optional<std::int64_t>
+{
+    auto function = this->entry(name);
+    if (function == nullptr) {
+        this->error_string = "no function '" + std::string(name) + "'";
+        return std::nullopt;
+    }
+    auto result = function();
+    switch (static_cast<division_status>(result.status)) {
+    case division_status::defined:
+        break;
+    case division_status::by_zero:
+        this->error_string = "division by zero in function '" + std::string(name) + "'";
+        return std::nullopt;
+    case division_status::overflows:
+        this->error_string = "division overflows in function '" + std::string(name) + "'";
+        return std::nullopt;
+    }
+    return result.value;
+}
+
+auto jit::load(const std::string& text) -> void
+{
+    auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    this->length = (text.size() + page - 1) / page * page;
+    if (this->length == 0) {
+        this->length = page;
+    }
+
+    void* memory = ::mmap(nullptr, this->length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        this->error_string = std::string("mmap : ") + std::strerror(errno);
+        return;
+    }
+    this->memory = memory;
+
+    std::memcpy(this->memory, text.data(), text.size());
+    if (::mprotect(this->memory, this->length, PROT_READ | PROT_EXEC) < 0) {
+        this->error_string = std::string("mprotect : ") + std::strerror(errno);
+        ::munmap(this->memory, this->length);
+        this->memory = nullptr;
+    }
+}
+
+} // namespace monoa::backend
@@ -0,0 +1,72 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_BACKEND_JIT_HPP
+#define MONOA_BACKEND_JIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <backend/encoder.hpp>
+
+namespace monoa::backend {
+
+// What generated functions leave in rax and rdx, following the System V
+// calling convention for a pair of integers. The status is only meaningful
+// for code emitted with checked division.
+struct native_result
+{
+    std::int64_t value;
+    std::uint64_t status;
+};
+
+using native_function = native_result (*)();
+
+// Loads encoded text into anonymous memory of this process so that its
+// functions can be called directly. The pages are written first and only
+// then made executable, they are never writable and executable at once.
+class jit
+{
+public:
+    jit(const std::string& text, const std::vector<symbol>* symbols);
+    jit(const jit&) = delete;
+    auto operator=(const jit&) -> jit& = delete;
+    ~jit();
+    auto error() -> std::optional<std::string>;
+    auto address(std::string_view name) -> const void*;
+    // Entry point of a function taking no arguments, null when it does not exist.
+    auto entry(std::string_view name) -> native_function;
+    // Calls a function emitted with checked division, nothing when it does
+    // not exist or divides by zero or overflows.
+    auto call(std::string_view name) -> std::optional<std::int64_t>;
+
+private:
+    std::optional<std::string> error_string;
+    void* memory = nullptr;
+    std::size_t length = 0;
+    std::vector<symbol> symbols;
+
+    auto load(const std::string& text) -> void;
+};
+
+} // namespace monoa::backend
+
+#endif // MONOA_BACKEND_JIT_HPP
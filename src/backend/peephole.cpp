@@ -0,0 +1,225 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <backend/peephole.hpp>
+
+namespace {
+
+using namespace monoa::backend;
+using replacement = std::optional<std::vector<machine_record>>;
+
+// Only full width registers, a 32 bit move to itself clears the upper half.
+auto is_register(const machine_operand& operand) -> bool
+{
+    return operand.is_register() && operand.width == 64;
+}
+
+auto is_location(const machine_operand& operand) -> bool
+{
+    return is_register(operand) || operand.is_memory();
+}
+
+auto make_move(machine_operand destination, machine_operand source) -> machine_record
+{
+    return machine_record::make_command(mnemonic::mov, {destination, source});
+}
+
+// mov reg, reg
+auto self_move(const machine_record* records) -> replacement
+{
+    const auto& move = records[0];
+    if (move.is_command(mnemonic::mov) && is_register(move.operands[0]) && move.operands[0] == move.operands[1]) {
+        return std::vector<machine_record>{};
+    }
+    return std::nullopt;
+}
+
+// add rsp, 0 and sub rsp, 0
+auto zero_stack_adjust(const machine_record* records) -> replacement
+{
+    const auto& adjust = records[0];
+    if ((adjust.is_command(mnemonic::add) || adjust.is_command(mnemonic::sub)) &&
+        adjust.operands[0] == machine_operand::make_register(rsp) &&
+        adjust.operands[1] == machine_operand::make_immediate(0)) {
+        return std::vector<machine_record>{};
+    }
+    return std::nullopt;
+}
+
+// push x; pop reg, the value never needed to go through the stack.
+auto push_pop(const machine_record* records) -> replacement
+{
+    const auto& push = records[0];
+    const auto& pop = records[1];
+    if (!push.is_command(mnemonic::push) || !pop.is_command(mnemonic::pop) || !is_register(pop.operands[0])) {
+        return std::nullopt;
+    }
+    if (push.operands[0] == pop.operands[0]) {
+        return std::vector<machine_record>{};
+    }
+    return std::vector<machine_record>{make_move(pop.operands[0], push.operands[0])};
+}
+
+// mov [m], reg; mov reg2, [m], the value is still in reg.
+auto store_reload(const machine_record* records) -> replacement
+{
+    const auto& store = records[0];
+    const auto& load = records[1];
+    if (!store.is_command(mnemonic::mov) || !load.is_command(mnemonic::mov) || !store.operands[0].is_memory() ||
+        !is_register(store.operands[1]) || !is_register(load.operands[0]) || load.operands[1] != store.operands[0]) {
+        return std::nullopt;
+    }
+    if (load.operands[0] == store.operands[1]) {
+        return std::vector<machine_record>{store};
+    }
+    return std::vector<machine_record>{store, make_move(load.operands[0], store.operands[1])};
+}
+
+// mov a, b; mov b, a, the second move copies back what is already there.
+auto move_back(const machine_record* records) -> replacement
+{
+    const auto& first = records[0];
+    const auto& second = records[1];
+    if (first.is_command(mnemonic::mov) && second.is_command(mnemonic::mov) &&
+        first.operands[0] == second.operands[1] && first.operands[1] == second.operands[0] &&
+        is_location(first.operands[0]) && is_location(first.operands[1])) {
+        return std::vector<machine_record>{first};
+    }
+    return std::nullopt;
+}
+
+// mov reg, x; mov reg, y, when y does not read reg the first move is dead.
+auto overwritten_move(const machine_record* records) -> replacement
+{
+    const auto& first = records[0];
+    const auto& second = records[1];
+    if (first.is_command(mnemonic::mov) && second.is_command(mnemonic::mov) && is_register(first.operands[0]) &&
+        first.operands[0] == second.operands[0] && !second.operands[1].uses(first.operands[0].reg)) {
+        return std::vector<machine_record>{second};
+    }
+    return std::nullopt;
+}
+
+// Commands between an unconditional transfer and the next label never run.
+auto unreachable(const machine_record* records) -> replacement
+{
+    const auto& transfer = records[0];
+    if ((transfer.is_command(mnemonic::jmp) || transfer.is_command(mnemonic::ret)) &&
+        records[1].kind == machine_record::kind::command) {
+        return std::vector<machine_record>{transfer};
+    }
+    return std::nullopt;
+}
+
+// jmp .l; .l:
+auto jump_to_next(const machine_record* records) -> replacement
+{
+    const auto& jump = records[0];
+    const auto& target = records[1];
+    if (jump.is_command(mnemonic::jmp) && target.kind == machine_record::kind::label &&
+        jump.operands[0] == target.operands[0]) {
+        return std::vector<machine_record>{target};
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+namespace monoa::backend {
+
+auto peephole_rules() -> const std::vector<peephole_rule>&
+{
+    static const std::vector<peephole_rule> rules = {
+        {"self-move", 1, self_move},
+        {"zero-stack-adjust", 1, zero_stack_adjust},
+        {"push-pop", 2, push_pop},
+        {"store-reload", 2, store_reload},
+        {"move-back", 2, move_back},
+        {"overwritten-move", 2, overwritten_move},
+        {"unreachable", 2, unreachable},
+        {"jump-to-next", 2, jump_to_next},
+    };
+    return rules;
+}
+
+auto command_count(const std::vector<machine_record>& code) -> std::size_t
+{
+    return std::count_if(code.begin(), code.end(), [](const machine_record& record) {
+        return record.kind == machine_record::kind::command;
+    });
+}
+
+// Records before the window are final and go to `out`. The window reads
+// first from `pending`, a stack of rewritten and backed up records, then from
+// the code not reached yet.
+auto optimize(std::vector<machine_record>& code, const std::vector<peephole_rule>& rules) -> void
+{
+    std::size_t longest = 1;
+    for (const auto& rule : rules) {
+        longest = std::max(longest, rule.window);
+    }
+
+    std::vector<machine_record> out;
+    out.reserve(code.size());
+    std::vector<machine_record> pending;
+    std::size_t next = 0;
+    auto drop = [&pending, &next]() {
+        if (!pending.empty()) {
+            pending.pop_back();
+        } else {
+            next++;
+        }
+    };
+
+    std::vector<machine_record> window(longest);
+    while (!pending.empty() || next < code.size()) {
+        auto available = std::min(longest, pending.size() + code.size() - next);
+        for (std::size_t k = 0; k < available; k++) {
+            window[k] = k < pending.size() ? pending[pending.size() - 1 - k] : code[next + k - pending.size()];
+        }
+
+        bool rewritten = false;
+        for (const auto& rule : rules) {
+            if (rule.window > available) {
+                continue;
+            }
+            auto records = rule.apply(window.data());
+            if (!records.has_value()) {
+                continue;
+            }
+            for (std::size_t k = 0; k < rule.window; k++) {
+                drop();
+            }
+            pending.insert(pending.end(), records->rbegin(), records->rend());
+            for (std::size_t k = 0; k + 1 < longest && !out.empty(); k++) {
+                pending.push_back(out.back());
+                out.pop_back();
+            }
+            rewritten = true;
+            break;
+        }
+        if (!rewritten) {
+            out.push_back(window[0]);
+            drop();
+        }
+    }
+    code.swap(out);
+}
+
+} // namespace monoa::backend
@@ -0,0 +1,57 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_BACKEND_PEEPHOLE_HPP
+#define MONOA_BACKEND_PEEPHOLE_HPP
+
+#include <optional>
+#include <string>
+#include <vector>
+#include <backend/assembly.hpp>
+
+namespace monoa::backend {
+
+// A rule looks at `window` consecutive records and returns the records
+// replacing them when it applies. Replacements must be shorter than the window
+// or no longer match the rule, so that rewriting terminates.
+struct peephole_rule
+{
+    const char* name;
+    std::size_t window;
+    std::optional<std::vector<machine_record>> (*apply)(const machine_record* records);
+};
+
+struct peephole_report
+{
+    std::string function;
+    std::size_t before;
+    std::size_t after;
+};
+
+auto peephole_rules() -> const std::vector<peephole_rule>&;
+auto command_count(const std::vector<machine_record>& code) -> std::size_t;
+
+// Slides a window over the code applying the first matching rule, then backs
+// up far enough for the rewritten records to take part in new matches. The
+// result is built in a second vector, a rewrite costs the size of its window
+// and not the length of the code after it.
+auto optimize(std::vector<machine_record>& code, const std::vector<peephole_rule>& rules = peephole_rules()) -> void;
+
+} // namespace monoa::backend
+
+#endif // MONOA_BACKEND_PEEPHOLE_HPP
@@ -0,0 +1,813 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <backend/x86.hpp>
+#include <support/thread_pool.hpp>
+
+namespace {
+
+using namespace monoa;
+using namespace monoa::backend;
+
+// The first eleven registers are allocated, rax and r11 stay scratch along
+// with rdx, which division clobbers.
+const std::uint8_t allocatable_registers[] = {rcx, rsi, rdi, r8, r9, r10, rbx, r12, r13, r14, r15};
+
+constexpr unsigned int register_count = sizeof(allocatable_registers) / sizeof(allocatable_registers[0]);
+constexpr unsigned int first_callee_saved = 6;
+
+// Below this many functions starting threads costs more than it saves.
+constexpr std::size_t parallel_threshold = 64;
+
+auto fits_immediate(std::uint64_t bits) -> bool
+{
+    auto value = static_cast<std::int64_t>(bits);
+    return value >= std::numeric_limits<std::int32_t>::min() && value <= std::numeric_limits<std::int32_t>::max();
+}
+
+auto same_location(location a, location b) -> bool
+{
+    return a.spilled == b.spilled && a.index == b.index;
+}
+
+auto block_label(ir::block_id block) -> machine_operand
+{
+    return machine_operand::make_label(label_kind::block, block);
+}
+
+auto reg(std::uint8_t number, std::uint8_t width = 64) -> machine_operand
+{
+    return machine_operand::make_register(number, width);
+}
+
+auto immediate(std::int64_t value) -> machine_operand
+{
+    return machine_operand::make_immediate(value);
+}
+
+auto smallest(ast::basic_type type) -> std::int64_t
+{
+    switch (type) {
+    case ast::basic_type::i8:
+        return std::numeric_limits<std::int8_t>::min();
+    case ast::basic_type::i16:
+        return std::numeric_limits<std::int16_t>::min();
+    case ast::basic_type::i32:
+        return std::numeric_limits<std::int32_t>::min();
+    default:
+        return std::numeric_limits<std::int64_t>::min();
+    }
+}
+
+} // namespace
+
+namespace monoa::backend {
+
+x86::x86(const ir::module* module, options options) : settings(options)
+{
+    this->emit_prelude();
+    {
+        support::scoped_timer timer(this->settings.timer, "codegen", "ir insts");
+        if (timer.active()) {
+            timer.set_items(ir::instruction_count(*module));
+        }
+        this->emit_functions(*module);
+    }
+    this->link();
+}
+
+x86::x86(std::vector<emitted_function> functions, options options) : settings(options), emitted(std::move(functions))
+{
+    this->emit_prelude();
+    this->link();
+}
+
+auto x86::result() -> std::string
+{
+    support::scoped_timer timer(this->settings.timer, "render", "bytes");
+    std::string result;
+    result += "section .data\n";
+    result += this->section_data;
+    result += "section .text\n";
+    this->text.render(result);
+    timer.set_items(result.size());
+    return result;
+}
+
+auto x86::error() -> std::optional<std::string>
+{
+    return this->error_string;
+}
+
+auto x86::peephole_reports() -> const std::vector<peephole_report>&
+{
+    return this->reports;
+}
+
+auto x86::program() -> const assembly&
+{
+    return this->text;
+}
+
+auto x86::functions() -> const std::vector<emitted_function>&
+{
+    return this->emitted;
+}
+
+// Entry point, calls main and exits with its result.
+auto x86::emit_prelude() -> void
+{
+    auto start = this->text.intern("_start");
+    auto main = this->text.intern("main");
+    auto& records = this->text.records;
+    records.push_back(machine_record::make_global(start, false));
+    records.push_back(machine_record::make_label(machine_operand::make_label(label_kind::symbol, start)));
+    records.push_back(machine_record::make_command(mnemonic::sub, {reg(rsp), immediate(8)}));
+    records.push_back(
+        machine_record::make_command(mnemonic::call, {machine_operand::make_label(label_kind::symbol, main)}));
+    records.push_back(machine_record::make_command(mnemonic::mov, {reg(rdi), reg(rax)}));
+    records.push_back(machine_record::make_command(mnemonic::mov, {reg(rax), immediate(60)}));
+    records.push_back(machine_record::make_command(mnemonic::syscall));
+}
+
+// Functions are emitted on their own, each into records that refer to its
+// own symbol as symbol zero.
+auto x86::emit_functions(const ir::module& module) -> void
+{
+    auto function_count = module.functions.size();
+    this->emitted.resize(function_count);
+
+    unsigned int threads = this->settings.threads == 0 ? support::hardware_threads() : this->settings.threads;
+    if (function_count < parallel_threshold) {
+        threads = 1;
+    }
+    std::vector<function_emitter> emitters(threads, function_emitter(this->settings));
+
+    auto emit = [&](unsigned int worker, std::size_t i) {
+        auto& emitter = emitters[worker];
+        const auto& function = module.functions[i];
+        emitter.emit(function, 0);
+        auto& emitted = this->emitted[i];
+        emitted.symbols.assign(1, function.name);
+        emitted.records = emitter.records();
+        emitted.report = emitter.report();
+    };
+    if (threads == 1) {
+        for (std::size_t i = 0; i < function_count; i++) {
+            emit(0, i);
+        }
+    } else {
+        support::thread_pool pool(threads);
+        pool.for_each(function_count, emit);
+    }
+}
+
+auto x86::link() -> void
+{
+    std::size_t total = this->text.records.size();
+    for (const auto& function : this->emitted) {
+        total += function.records.size();
+    }
+    support::scoped_timer timer(this->settings.timer, "link", "records", total);
+    this->text.records.reserve(total);
+    this->reports.reserve(this->emitted.size());
+    for (const auto& function : this->emitted) {
+        append_function(function, this->text);
+        this->reports.push_back(function.report);
+    }
+}
+
+function_emitter::function_emitter(options options) : settings(options)
+{
+}
+
+auto function_emitter::records() -> const std::vector<machine_record>&
+{
+    return this->code;
+}
+
+auto function_emitter::report() -> const peephole_report&
+{
+    return this->last_report;
+}
+
+auto function_emitter::emit(const ir::function& function, std::uint32_t symbol) -> void
+{
+    this->function = &function;
+    this->code.clear();
+    this->edge_labels = 0;
+    this->traps = {};
+    this->allocate_registers();
+
+    this->code.push_back(machine_record::make_global(symbol, true));
+    this->label(machine_operand::make_label(label_kind::symbol, symbol));
+
+    unsigned int frame_size = this->spill_slots * 8;
+    if (this->spill_slots > 0) {
+        this->command(mnemonic::push, {reg(rbp)});
+        this->command(mnemonic::mov, {reg(rbp), reg(rsp)});
+    }
+    for (auto saved : this->saved_registers) {
+        this->command(mnemonic::push, {::reg(saved)});
+    }
+    if (frame_size > 0) {
+        this->command(mnemonic::sub, {reg(rsp), immediate(frame_size)});
+    }
+
+    auto predecessors = function.predecessors();
+    bool jumps_to_return = false;
+    auto block_count = static_cast<ir::block_id>(function.blocks.size());
+    for (ir::block_id block = 0; block < block_count; block++) {
+        if (!predecessors[block].empty()) {
+            this->label(block_label(block));
+        }
+        bool last_block = block + 1 == block_count;
+
+        for (const auto& instruction : function.blocks[block].instructions) {
+            switch (instruction.code) {
+            case ir::opcode::add:
+            case ir::opcode::sub:
+            case ir::opcode::mul:
+            case ir::opcode::div:
+                this->emit_binary(instruction);
+                break;
+            case ir::opcode::convert:
+                this->emit_convert(instruction);
+                break;
+            case ir::opcode::phi:
+                break;
+            case ir::opcode::ret:
+                if (instruction.left.is_constant() && instruction.left.data == 0) {
+                    this->command(mnemonic::xor_, {reg(rax, 32), reg(rax, 32)});
+                } else {
+                    this->command(mnemonic::mov, {reg(rax), this->value_operand(instruction.left)});
+                }
+                if (!last_block) {
+                    this->command(mnemonic::jmp, {machine_operand::make_label(label_kind::exit, 0)});
+                    jumps_to_return = true;
+                }
+                break;
+            case ir::opcode::jump:
+                this->emit_moves(this->phi_moves(block, instruction.targets[0]));
+                if (instruction.targets[0] != block + 1) {
+                    this->command(mnemonic::jmp, {block_label(instruction.targets[0])});
+                }
+                break;
+            case ir::opcode::branch: {
+                auto condition = this->value_operand(instruction.left);
+                if (instruction.left.is_constant()) {
+                    this->command(mnemonic::mov, {reg(r11), condition});
+                    condition = reg(r11);
+                }
+                this->command(mnemonic::cmp, {condition, immediate(0)});
+                // Copies for the taken edge need a stub of their own, the
+                // not taken edge just falls through the conditional jump.
+                auto taken_moves = this->phi_moves(block, instruction.targets[0]);
+                if (taken_moves.empty()) {
+                    this->command(mnemonic::jne, {block_label(instruction.targets[0])});
+                } else {
+                    auto not_taken = machine_operand::make_label(label_kind::edge, this->edge_labels++);
+                    this->command(mnemonic::je, {not_taken});
+                    this->emit_moves(std::move(taken_moves));
+                    this->command(mnemonic::jmp, {block_label(instruction.targets[0])});
+                    this->label(not_taken);
+                }
+                this->emit_moves(this->phi_moves(block, instruction.targets[1]));
+                if (instruction.targets[1] != block + 1) {
+                    this->command(mnemonic::jmp, {block_label(instruction.targets[1])});
+                }
+                break;
+            }
+            }
+        }
+    }
+
+    if (jumps_to_return) {
+        this->label(machine_operand::make_label(label_kind::exit, 0));
+    }
+    if (this->settings.checked_division) {
+        this->command(mnemonic::xor_, {reg(rdx, 32), reg(rdx, 32)});
+    }
+    // Stubs leaving with a failing status join the return past the status of
+    // a defined result.
+    bool trapped = this->traps[0].has_value() || this->traps[1].has_value();
+    auto leave = machine_operand::make_label(label_kind::edge, this->edge_labels);
+    if (trapped) {
+        this->edge_labels++;
+        this->label(leave);
+    }
+    if (frame_size > 0) {
+        this->command(mnemonic::add, {reg(rsp), immediate(frame_size)});
+    }
+    for (auto it = this->saved_registers.rbegin(); it != this->saved_registers.rend(); it++) {
+        this->command(mnemonic::pop, {reg(*it)});
+    }
+    if (this->spill_slots > 0) {
+        this->command(mnemonic::pop, {reg(rbp)});
+    }
+    this->command(mnemonic::ret);
+    for (std::size_t i = 0; i < this->traps.size(); i++) {
+        if (this->traps[i].has_value()) {
+            this->label(machine_operand::make_label(label_kind::edge, this->traps[i].value()));
+            this->command(mnemonic::mov, {reg(rdx, 32), immediate(static_cast<std::int64_t>(i + 1))});
+            this->command(mnemonic::jmp, {leave});
+        }
+    }
+
+    this->last_report = peephole_report{function.name, command_count(this->code), 0};
+    if (this->settings.peephole) {
+        optimize(this->code);
+    }
+    this->last_report.after = command_count(this->code);
+}
+
+// Instructions are numbered in block order, each value gets the single range
+// from its first to its last position, stretched over every block it is live
+// across. Phi results are written at the end of their predecessors and phi
+// operands read there, both count as positions of the predecessor terminator.
+auto function_emitter::allocate_registers() -> void
+{
+    const auto& function = *this->function;
+    auto value_count = function.value_count();
+    auto block_count = function.blocks.size();
+
+    std::vector<unsigned int> block_start(block_count);
+    std::vector<unsigned int> block_end(block_count);
+    unsigned int position = 0;
+    for (std::size_t block = 0; block < block_count; block++) {
+        block_start[block] = position;
+        position += static_cast<unsigned int>(function.blocks[block].instructions.size());
+        block_end[block] = position - 1;
+    }
+
+    std::vector<unsigned int> start(value_count, std::numeric_limits<unsigned int>::max());
+    std::vector<unsigned int> end(value_count, 0);
+    auto touch = [&](ir::value_id value, unsigned int at) {
+        start[value] = std::min(start[value], at);
+        end[value] = std::max(end[value], at);
+    };
+
+    // Liveness over sorted sets of values. Every value is defined once, so a
+    // block kills the values it defines and gen holds the values it reads
+    // that are defined elsewhere, phi operands are read by the predecessor.
+    std::vector<ir::block_id> defined_in(value_count, 0);
+    for (std::size_t block = 0; block < block_count; block++) {
+        for (const auto& instruction : function.blocks[block].instructions) {
+            if (instruction.has_result()) {
+                defined_in[instruction.result] = static_cast<ir::block_id>(block);
+            }
+        }
+    }
+
+    std::vector<std::vector<ir::value_id>> gen(block_count);
+    std::vector<std::vector<ir::value_id>> phi_uses(block_count);
+    for (std::size_t block = 0; block < block_count; block++) {
+        unsigned int at = block_start[block];
+        for (const auto& instruction : function.blocks[block].instructions) {
+            if (instruction.code == ir::opcode::phi) {
+                touch(instruction.result, block_start[block]);
+                for (const auto& incoming : instruction.incomings) {
+                    touch(instruction.result, block_end[incoming.block]);
+                    if (incoming.value.is_value()) {
+                        touch(incoming.value.id(), block_end[incoming.block]);
+                        phi_uses[incoming.block].push_back(incoming.value.id());
+                    }
+                }
+            } else {
+                for (auto use : {instruction.left, instruction.right}) {
+                    if (use.is_value()) {
+                        touch(use.id(), at);
+                        if (defined_in[use.id()] != block) {
+                            gen[block].push_back(use.id());
+                        }
+                    }
+                }
+                if (instruction.has_result()) {
+                    touch(instruction.result, at);
+                }
+            }
+            at++;
+        }
+    }
+    auto make_set = [](std::vector<ir::value_id>& values) {
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+    };
+    for (std::size_t block = 0; block < block_count; block++) {
+        make_set(gen[block]);
+        make_set(phi_uses[block]);
+    }
+
+    std::vector<std::vector<ir::value_id>> live_in(block_count);
+    std::vector<std::vector<ir::value_id>> live_out(block_count);
+    std::vector<ir::value_id> out;
+    std::vector<ir::value_id> in;
+    std::vector<ir::value_id> merged;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (std::size_t block = block_count; block > 0; block--) {
+            auto b = static_cast<ir::block_id>(block - 1);
+            out = phi_uses[b];
+            for (auto successor : function.successors(b)) {
+                // Phi results are killed at the top of their block and never live in.
+                merged.clear();
+                std::set_union(out.begin(),
+                               out.end(),
+                               live_in[successor].begin(),
+                               live_in[successor].end(),
+                               std::back_inserter(merged));
+                out.swap(merged);
+            }
+            merged.clear();
+            std::copy_if(out.begin(), out.end(), std::back_inserter(merged), [&](ir::value_id value) {
+                return defined_in[value] != b;
+            });
+            in.clear();
+            std::set_union(gen[b].begin(), gen[b].end(), merged.begin(), merged.end(), std::back_inserter(in));
+            if (out != live_out[b] || in != live_in[b]) {
+                live_out[b].swap(out);
+                live_in[b].swap(in);
+                changed = true;
+            }
+        }
+    }
+
+    for (std::size_t block = 0; block < block_count; block++) {
+        for (auto value : live_in[block]) {
+            touch(value, block_start[block]);
+        }
+        for (auto value : live_out[block]) {
+            touch(value, block_end[block]);
+        }
+    }
+
+    std::vector<ir::value_id> order;
+    for (ir::value_id value = 0; value < value_count; value++) {
+        if (start[value] != std::numeric_limits<unsigned int>::max()) {
+            order.push_back(value);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](ir::value_id a, ir::value_id b) { return start[a] < start[b]; });
+
+    this->locations.assign(value_count, location{});
+    this->spill_slots = 0;
+
+    std::vector<bool> used(register_count, false);
+    std::vector<unsigned int> free_registers;
+    for (unsigned int reg = 0; reg < register_count; reg++) {
+        free_registers.push_back(reg);
+    }
+    // Active values, kept sorted by increasing end.
+    std::vector<ir::value_id> active;
+    auto insert_active = [&](ir::value_id value) {
+        auto position = std::upper_bound(
+            active.begin(), active.end(), value, [&](ir::value_id a, ir::value_id b) { return end[a] < end[b]; });
+        active.insert(position, value);
+    };
+
+    for (auto value : order) {
+        // A value read for the last time by the instruction defining another
+        // one can hand its register over, the emitter copes with the overlap.
+        while (!active.empty() && end[active.front()] <= start[value]) {
+            free_registers.push_back(this->locations[active.front()].index);
+            active.erase(active.begin());
+        }
+
+        if (!free_registers.empty()) {
+            // Lowest numbered register first, caller saved registers come first.
+            auto best = std::min_element(free_registers.begin(), free_registers.end());
+            this->locations[value] = location{false, *best};
+            used[*best] = true;
+            free_registers.erase(best);
+            insert_active(value);
+        } else if (end[active.back()] > end[value]) {
+            auto victim = active.back();
+            active.pop_back();
+            this->locations[value] = this->locations[victim];
+            this->locations[victim] = location{true, this->spill_slots++};
+            insert_active(value);
+        } else {
+            this->locations[value] = location{true, this->spill_slots++};
+        }
+    }
+
+    this->saved_registers.clear();
+    for (unsigned int index = first_callee_saved; index < register_count; index++) {
+        if (used[index]) {
+            this->saved_registers.push_back(allocatable_registers[index]);
+        }
+    }
+    for (auto& where : this->locations) {
+        if (!where.spilled) {
+            where.index = allocatable_registers[where.index];
+        }
+    }
+}
+
+auto function_emitter::location_operand(location where) -> machine_operand
+{
+    if (!where.spilled) {
+        return reg(where.index);
+    }
+    // Slots sit below the saved rbp and the callee saved registers.
+    auto offset = 8 * (this->saved_registers.size() + where.index + 1);
+    return machine_operand::make_memory(rbp, -static_cast<std::int64_t>(offset));
+}
+
+auto function_emitter::value_operand(ir::operand value) -> machine_operand
+{
+    if (value.is_constant()) {
+        return immediate(static_cast<std::int64_t>(value.data));
+    }
+    return this->location_operand(this->locations[value.id()]);
+}
+
+// Values narrower than 64 bits are kept sign or zero extended in their
+// register, so that widening conversions are plain moves.
+auto function_emitter::extend(std::uint8_t target, ast::basic_type type) -> void
+{
+    switch (type) {
+    case ast::basic_type::i32:
+        this->command(mnemonic::movsxd, {reg(target), reg(target, 32)});
+        break;
+    case ast::basic_type::u32:
+        this->command(mnemonic::mov, {reg(target, 32), reg(target, 32)});
+        break;
+    case ast::basic_type::i16:
+        this->command(mnemonic::movsx, {reg(target), reg(target, 16)});
+        break;
+    case ast::basic_type::u16:
+        this->command(mnemonic::movzx, {reg(target), reg(target, 16)});
+        break;
+    case ast::basic_type::i8:
+        this->command(mnemonic::movsx, {reg(target), reg(target, 8)});
+        break;
+    case ast::basic_type::u8:
+        this->command(mnemonic::movzx, {reg(target), reg(target, 8)});
+        break;
+    default:
+        break;
+    }
+}
+
+auto function_emitter::emit_binary(const ir::instruction& instruction) -> void
+{
+    auto destination = this->locations[instruction.result];
+    auto destination_operand = this->location_operand(destination);
+    auto left = instruction.left;
+    auto right = instruction.right;
+
+    if (instruction.code == ir::opcode::div) {
+        this->command(mnemonic::mov, {reg(rax), this->value_operand(left)});
+        auto divisor = this->value_operand(right);
+        if (this->settings.checked_division) {
+            this->check_division(instruction.type, right, divisor);
+        }
+        if (right.is_constant()) {
+            this->command(mnemonic::mov, {reg(r11), divisor});
+            divisor = reg(r11);
+        }
+        if (ast::is_unsigned(instruction.type)) {
+            this->command(mnemonic::xor_, {reg(rdx, 32), reg(rdx, 32)});
+            this->command(mnemonic::div, {divisor});
+        } else {
+            this->command(mnemonic::cqo);
+            this->command(mnemonic::idiv, {divisor});
+        }
+        this->extend(rax, instruction.type);
+        this->command(mnemonic::mov, {destination_operand, reg(rax)});
+        return;
+    }
+
+    auto same_place = [this](ir::operand value, location where) {
+        return value.is_value() && same_location(this->locations[value.id()], where);
+    };
+
+    bool commutative = instruction.code != ir::opcode::sub;
+    if (commutative && same_place(right, destination)) {
+        std::swap(left, right);
+    }
+
+    auto source = this->value_operand(right);
+    if (right.is_constant() && !fits_immediate(right.data)) {
+        this->command(mnemonic::mov, {reg(r11), source});
+        source = reg(r11);
+    }
+
+    // x86 operations are two-address, work in rax when the destination is
+    // in memory or would be overwritten before the right operand is read.
+    bool through_scratch = destination.spilled || same_place(right, destination);
+    std::uint8_t target = rax;
+    if (!through_scratch) {
+        target = static_cast<std::uint8_t>(destination.index);
+    }
+    if (through_scratch || !same_place(left, destination)) {
+        this->command(mnemonic::mov, {reg(target), this->value_operand(left)});
+    }
+
+    switch (instruction.code) {
+    case ir::opcode::add:
+        this->command(mnemonic::add, {reg(target), source});
+        break;
+    case ir::opcode::sub:
+        this->command(mnemonic::sub, {reg(target), source});
+        break;
+    case ir::opcode::mul:
+        if (source.is_immediate()) {
+            this->command(mnemonic::imul, {reg(target), reg(target), source});
+        } else {
+            this->command(mnemonic::imul, {reg(target), source});
+        }
+        break;
+    default:
+        break;
+    }
+    this->extend(target, instruction.type);
+
+    if (through_scratch) {
+        this->command(mnemonic::mov, {destination_operand, reg(rax)});
+    }
+}
+
+// Jumps to a trap stub rather than dividing rax by zero, or the smallest
+// value of a signed type by -1. Narrow values are kept extended in their
+// register, so comparing all 64 bits is enough.
+auto function_emitter::check_division(ast::basic_type type, ir::operand right, machine_operand divisor) -> void
+{
+    bool is_signed = !ast::is_unsigned(type);
+    auto compare_smallest = [this, type]() {
+        if (type == ast::basic_type::i64) {
+            this->command(mnemonic::mov, {reg(rdx), immediate(smallest(type))});
+            this->command(mnemonic::cmp, {reg(rax), reg(rdx)});
+        } else {
+            this->command(mnemonic::cmp, {reg(rax), immediate(smallest(type))});
+        }
+    };
+
+    if (right.is_constant()) {
+        auto value = static_cast<std::int64_t>(right.data);
+        if (value == 0) {
+            this->command(mnemonic::jmp, {this->trap(division_status::by_zero)});
+        } else if (is_signed && value == -1) {
+            compare_smallest();
+            this->command(mnemonic::je, {this->trap(division_status::overflows)});
+        }
+        return;
+    }
+
+    this->command(mnemonic::cmp, {divisor, immediate(0)});
+    this->command(mnemonic::je, {this->trap(division_status::by_zero)});
+    if (is_signed) {
+        auto defined = machine_operand::make_label(label_kind::edge, this->edge_labels++);
+        this->command(mnemonic::cmp, {divisor, immediate(-1)});
+        this->command(mnemonic::jne, {defined});
+        compare_smallest();
+        this->command(mnemonic::je, {this->trap(division_status::overflows)});
+        this->label(defined);
+    }
+}
+
+auto function_emitter::trap(division_status status) -> machine_operand
+{
+    auto& stub = this->traps[static_cast<std::size_t>(status) - 1];
+    if (!stub.has_value()) {
+        stub = this->edge_labels++;
+    }
+    return machine_operand::make_label(label_kind::edge, stub.value());
+}
+
+auto function_emitter::emit_convert(const ir::instruction& instruction) -> void
+{
+    auto destination = this->locations[instruction.result];
+    std::uint8_t target = rax;
+    if (!destination.spilled) {
+        target = static_cast<std::uint8_t>(destination.index);
+    }
+    this->command(mnemonic::mov, {reg(target), this->value_operand(instruction.left)});
+    this->extend(target, instruction.type);
+    if (destination.spilled) {
+        this->command(mnemonic::mov, {this->location_operand(destination), reg(rax)});
+    }
+}
+
+auto function_emitter::phi_moves(ir::block_id from, ir::block_id to) -> std::vector<move>
+{
+    std::vector<move> moves;
+    for (const auto& instruction : this->function->blocks[to].instructions) {
+        if (instruction.code != ir::opcode::phi) {
+            break;
+        }
+        for (const auto& incoming : instruction.incomings) {
+            if (incoming.block != from) {
+                continue;
+            }
+            move copy{this->locations[instruction.result], incoming.value.is_constant(), incoming.value.data, {}};
+            if (incoming.value.is_value()) {
+                copy.source = this->locations[incoming.value.id()];
+            }
+            moves.push_back(copy);
+        }
+    }
+    return moves;
+}
+
+// Sequentializes a parallel copy, a move is safe once no pending move still
+// reads its destination. Cycles are broken by parking one value in r11.
+auto function_emitter::emit_moves(std::vector<move> moves) -> void
+{
+    moves.erase(std::remove_if(moves.begin(),
+                               moves.end(),
+                               [](const move& m) { return !m.constant && same_location(m.destination, m.source); }),
+                moves.end());
+
+    auto emit = [this](const move& m) {
+        auto destination = this->location_operand(m.destination);
+        if (m.constant) {
+            auto value = immediate(static_cast<std::int64_t>(m.bits));
+            if (m.destination.spilled && !fits_immediate(m.bits)) {
+                this->command(mnemonic::mov, {reg(rax), value});
+                this->command(mnemonic::mov, {destination, reg(rax)});
+            } else {
+                this->command(mnemonic::mov, {destination, value});
+            }
+        } else if (m.destination.spilled && m.source.spilled) {
+            this->command(mnemonic::mov, {reg(rax), this->location_operand(m.source)});
+            this->command(mnemonic::mov, {destination, reg(rax)});
+        } else {
+            this->command(mnemonic::mov, {destination, this->location_operand(m.source)});
+        }
+    };
+
+    while (!moves.empty()) {
+        auto ready = std::find_if(moves.begin(), moves.end(), [&moves](const move& candidate) {
+            return std::none_of(moves.begin(), moves.end(), [&candidate](const move& other) {
+                return !other.constant && &other != &candidate && same_location(other.source, candidate.destination);
+            });
+        });
+
+        if (ready != moves.end()) {
+            emit(*ready);
+            moves.erase(ready);
+            continue;
+        }
+
+        auto parked = moves.front().destination;
+        this->command(mnemonic::mov, {reg(r11), this->location_operand(parked)});
+        for (auto& m : moves) {
+            if (!m.constant && same_location(m.source, parked)) {
+                m.source = location{false, r11};
+            }
+        }
+    }
+}
+
+auto function_emitter::label(machine_operand name) -> void
+{
+    this->code.push_back(machine_record::make_label(name));
+}
+
+auto function_emitter::command(mnemonic code, std::initializer_list<machine_operand> operands) -> void
+{
+    this->code.push_back(machine_record::make_command(code, operands));
+}
+
+// Symbols of the function are mapped onto the program's, its local labels
+// need no change as they belong to the function's own symbol.
+auto append_function(const emitted_function& function, assembly& program) -> void
+{
+    std::vector<std::uint32_t> mapped;
+    mapped.reserve(function.symbols.size());
+    for (const auto& symbol : function.symbols) {
+        mapped.push_back(program.intern(symbol));
+    }
+    for (const auto& emitted : function.records) {
+        auto& record = program.records.emplace_back(emitted);
+        for (std::uint8_t j = 0; j < record.operand_count; j++) {
+            auto& operand = record.operands[j];
+            if (operand.is_label() && operand.label() == label_kind::symbol) {
+                operand.value = mapped[operand.value];
+            }
+        }
+    }
+}
+
+} // namespace monoa::backend
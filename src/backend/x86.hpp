@@ -0,0 +1,152 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_BACKEND_X86_HPP
+#define MONOA_BACKEND_X86_HPP
+
+#include <array>
+#include <optional>
+#include <string>
+#include <vector>
+#include <backend/assembly.hpp>
+#include <backend/peephole.hpp>
+#include <ir/ir.hpp>
+#include <support/timer.hpp>
+
+namespace monoa::backend {
+
+// Where a value lives for its whole lifetime, a register or a stack slot.
+struct location
+{
+    bool spilled = false;
+    unsigned int index = 0;
+};
+
+struct options
+{
+    bool peephole = true;
+    // Threads generating functions, zero for one per hardware thread.
+    unsigned int threads = 0;
+    // Phases of the build are timed into it when set, by every stage given
+    // these options.
+    support::pass_timer* timer = nullptr;
+    // Divisions by zero and divisions overflowing their type leave the
+    // function with a division_status in rdx instead of trapping, so that
+    // code running in this process can report them.
+    bool checked_division = false;
+};
+
+// Left in rdx by code emitted with checked division.
+enum class division_status : std::uint64_t
+{
+    defined,
+    by_zero,
+    overflows,
+};
+
+// Code of one function emitted on its own, the unit that incremental builds
+// keep. Symbol operands index `symbols`.
+struct emitted_function
+{
+    std::vector<std::string> symbols;
+    std::vector<machine_record> records;
+    peephole_report report;
+};
+
+// Emits the code of one function at a time into records of its own, so that
+// functions can be emitted on separate threads. Edge labels are numbered from
+// zero in every function, they are local to its symbol.
+class function_emitter
+{
+public:
+    function_emitter(options options);
+    auto emit(const ir::function& function, std::uint32_t symbol) -> void;
+    auto records() -> const std::vector<machine_record>&;
+    auto report() -> const peephole_report&;
+
+private:
+    struct move
+    {
+        location destination;
+        bool constant;
+        std::uint64_t bits;
+        location source;
+    };
+
+    options settings;
+    std::vector<machine_record> code;
+    peephole_report last_report;
+
+    const ir::function* function = nullptr;
+    std::vector<location> locations;
+    std::vector<unsigned int> saved_registers;
+    unsigned int spill_slots = 0;
+    unsigned int edge_labels = 0;
+    // Edge labels of the stubs leaving with each failing division_status,
+    // made on first use.
+    std::array<std::optional<unsigned int>, 2> traps;
+
+    auto allocate_registers() -> void;
+    auto location_operand(location where) -> machine_operand;
+    auto value_operand(ir::operand value) -> machine_operand;
+    auto extend(std::uint8_t target, ast::basic_type type) -> void;
+    auto emit_binary(const ir::instruction& instruction) -> void;
+    auto check_division(ast::basic_type type, ir::operand right, machine_operand divisor) -> void;
+    auto trap(division_status status) -> machine_operand;
+    auto emit_convert(const ir::instruction& instruction) -> void;
+    auto phi_moves(ir::block_id from, ir::block_id to) -> std::vector<move>;
+    auto emit_moves(std::vector<move> moves) -> void;
+    auto label(machine_operand name) -> void;
+    auto command(mnemonic code, std::initializer_list<machine_operand> operands = {}) -> void;
+};
+
+auto append_function(const emitted_function& function, assembly& program) -> void;
+
+// Emits NASM text for a verified module. Values are assigned to registers by
+// linear scan over single live ranges, phis are resolved into parallel
+// copies at the end of their predecessors. Functions are generated in
+// parallel and stitched together in module order, the output does not depend
+// on the number of threads.
+class x86
+{
+public:
+    x86(const ir::module* module, options options = {});
+    // Links functions emitted earlier, possibly by different modules.
+    x86(std::vector<emitted_function> functions, options options = {});
+    auto result() -> std::string;
+    auto error() -> std::optional<std::string>;
+    auto peephole_reports() -> const std::vector<peephole_report>&;
+    auto program() -> const assembly&;
+    auto functions() -> const std::vector<emitted_function>&;
+
+private:
+    std::optional<std::string> error_string;
+    options settings;
+    std::string section_data;
+    std::vector<emitted_function> emitted;
+    assembly text;
+    std::vector<peephole_report> reports;
+
+    auto emit_prelude() -> void;
+    auto emit_functions(const ir::module& module) -> void;
+    auto link() -> void;
+};
+
+} // namespace monoa::backend
+
+#endif // MONOA_BACKEND_X86_HPP
@@ -16,48 +16,540 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/resource.h>
+#include <ast/bytecode_compiler.hpp>
 #include <ast/compiler.hpp>
+#include <ast/folder.hpp>
 #include <ast/printer.hpp>
+#include <backend/elf.hpp>
+#include <backend/encoder.hpp>
+#include <backend/jit.hpp>
+#include <driver/incremental.hpp>
+#include <io/file.hpp>
 #include <parser/lexer.hpp>
 #include <parser/parser.hpp>
+#include <support/scheduler.hpp>
+#include <support/timer.hpp>
+#include <vm/interpreter.hpp>
+#include <vm/tiered.hpp>
 
 using namespace monoa;
 
-auto main(int argc, char* argv[]) -> int
+namespace {
+
+const char* usage = "usage: monoa [-o <output>] [-j <threads>] [--manifest <file>] [--stats] [--incremental]\n"
+                    "             [--no-fold] [--no-peephole] [--peephole-report] [--emit-ir | --emit-bytecode]\n"
+                    "             [--elf | --run | --vm | --tiered] [--tier-threshold <calls>] [--trace-tiers]\n"
+                    "             [--time-passes[=json]] <input>...\n";
+
+enum class pass_report
+{
+    none,
+    table,
+    json,
+};
+
+struct options
+{
+    bool fold = true;
+    bool emit_ir = false;
+    bool elf = false;
+    bool run = false;
+    bool emit_bytecode = false;
+    bool vm = false;
+    bool tiered = false;
+    bool trace_tiers = false;
+    vm::tier_options tiers;
+    bool peephole_report = false;
+    bool stats = false;
+    pass_report time_passes = pass_report::none;
+    bool incremental = false;
+    // Threads for the whole build, zero for one per hardware thread.
+    unsigned int jobs = 0;
+    backend::options backend;
+};
+
+// What building one input printed, kept until it can be shown in input order.
+struct build_result
 {
-    auto source = R"(
-fun main() -> i64
+    bool ok = false;
+    std::string out;
+    std::string err;
+};
+
+// Processor time of every thread so far, over wall time it tells how many
+// cores a build kept busy.
+auto cpu_seconds() -> double
 {
-    let a = 10;
-    return 74 - 10 + 44 * 99 - 346 / 2;
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
 }
 
-fun pow() -> i64
+auto output_path(const std::string& input, const options& options) -> std::string
 {
-    return 10;
+    std::string extension = options.emit_ir ? ".ir" : options.emit_bytecode ? ".bc" : options.elf ? "" : ".asm";
+    auto slash = input.find_last_of('/');
+    auto dot = input.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return input + extension;
+    }
+    return input.substr(0, dot) + extension;
 }
 
-)";
-    auto lexer = std::make_unique<parser::lexer>(source);
-    if (lexer->error().has_value()) {
-        std::cerr << "lexing error : " << lexer->error().value();
-        return EXIT_FAILURE;
+auto report_peephole(const std::vector<backend::peephole_report>& reports, std::ostream& out) -> void
+{
+    for (const auto& report : reports) {
+        out << "peephole : " << report.function << " " << report.before << " -> " << report.after
+            << " instructions (-" << report.before - report.after << ")" << std::endl;
     }
+}
 
-    auto parser = std::make_unique<parser::parser>(lexer->get_tokens());
+// Text, an executable or the result of running main, from anything that
+// produced a program.
+template <typename T>
+auto finish(T& compiled, const options& options, std::string& output, std::ostream& out, std::ostream& err) -> bool
+{
+    if (!options.elf && !options.run) {
+        output = compiled.result();
+        return true;
+    }
+
+    auto* timer = options.backend.timer;
+    std::unique_ptr<backend::encoder> encoder;
+    {
+        support::scoped_timer scope(timer, "encode", "records", compiled.program().records.size());
+        encoder = std::make_unique<backend::encoder>(&compiled.program());
+    }
+    if (encoder->error().has_value()) {
+        err << "encoding error : " << encoder->error().value() << std::endl;
+        return false;
+    }
+
+    if (options.run) {
+        std::unique_ptr<backend::jit> jit;
+        {
+            support::scoped_timer scope(timer, "load", "bytes", encoder->text().size());
+            jit = std::make_unique<backend::jit>(encoder->text(), &encoder->symbols());
+        }
+        if (jit->error().has_value()) {
+            err << "loading error : " << jit->error().value() << std::endl;
+            return false;
+        }
+        std::optional<std::int64_t> result;
+        {
+            support::scoped_timer scope(timer, "run", "calls", 1);
+            result = jit->call("main");
+        }
+        if (!result.has_value()) {
+            err << "running error : " << jit->error().value() << std::endl;
+            return false;
+        }
+        out << result.value() << std::endl;
+        return true;
+    }
+
+    std::unique_ptr<backend::elf_executable> executable;
+    {
+        support::scoped_timer scope(timer, "elf", "bytes", encoder->text().size());
+        executable = std::make_unique<backend::elf_executable>(encoder->text(), "", &encoder->symbols(), "_start");
+    }
+    if (executable->error().has_value()) {
+        err << "linking error : " << executable->error().value() << std::endl;
+        return false;
+    }
+    output = executable->result();
+    return true;
+}
+
+auto compile_incremental(std::string_view source,
+                         const options& options,
+                         const std::string& cache_path,
+                         std::string& output,
+                         std::ostream& out,
+                         std::ostream& err) -> bool
+{
+    auto incremental = std::make_unique<driver::incremental>(
+        source, cache_path, options.fold, !options.elf && !options.run, options.backend);
+    if (incremental->error().has_value()) {
+        err << incremental->error().value() << std::endl;
+        return false;
+    }
+    if (options.stats) {
+        out << "incremental : " << incremental->reused() << " functions reused, " << incremental->compiled()
+            << " compiled" << std::endl;
+    }
+    if (options.peephole_report) {
+        report_peephole(incremental->peephole_reports(), out);
+    }
+    return finish(*incremental, options, output, out, err);
+}
+
+// Result of main on the interpreter, or the tiered engine.
+template <typename T>
+auto run_main(T& engine, support::pass_timer* timer, std::ostream& out, std::ostream& err) -> bool
+{
+    if (engine.error().has_value()) {
+        err << "loading error : " << engine.error().value() << std::endl;
+        return false;
+    }
+    std::optional<std::int64_t> result;
+    {
+        support::scoped_timer scope(timer, "run", "calls", 1);
+        result = engine.call("main");
+    }
+    if (!result.has_value()) {
+        err << "running error : " << engine.error().value() << std::endl;
+        return false;
+    }
+    out << result.value() << std::endl;
+    return true;
+}
+
+// Bytecode text, or the result of running main on the interpreter.
+auto interpret(ast::root* ast, const options& options, std::string& output, std::ostream& out, std::ostream& err)
+    -> bool
+{
+    auto* timer = options.backend.timer;
+    std::unique_ptr<ast::bytecode_compiler> compiler;
+    {
+        support::scoped_timer scope(timer, "bytecode", "nodes", ast->memory.object_count());
+        compiler = std::make_unique<ast::bytecode_compiler>(ast);
+    }
+    if (compiler->error().has_value()) {
+        err << "compiling error : " << compiler->error().value() << std::endl;
+        return false;
+    }
+    if (!options.vm) {
+        output = vm::dump(compiler->result());
+        return true;
+    }
+
+    if (!options.tiered) {
+        auto interpreter = std::make_unique<vm::interpreter>(&compiler->result());
+        return run_main(*interpreter, timer, out, err);
+    }
+    auto settings = options.tiers;
+    settings.peephole = options.backend.peephole;
+    auto engine = std::make_unique<vm::tiered>(&compiler->result(), settings);
+    bool ok = run_main(*engine, timer, out, err);
+    if (options.trace_tiers) {
+        for (const auto& tier_up : engine->tier_ups()) {
+            out << "tier-up : " << tier_up.function << " after " << tier_up.calls << " calls, compiled in "
+                << tier_up.compile_seconds * 1e3 << " ms" << std::endl;
+        }
+    }
+    return ok;
+}
+
+auto compile(std::string_view source, const options& options, std::string& output, std::ostream& out, std::ostream& err)
+    -> bool
+{
+    // Tokens are lexed as the parser gets to them, a lexing error ends the
+    // stream early and comes before whatever the parser made of that. Timed
+    // builds lex the whole source first, to tell the two phases apart.
+    auto* timer = options.backend.timer;
+    std::unique_ptr<parser::lexer> lexer;
+    std::unique_ptr<parser::parser> parser;
+    if (timer == nullptr) {
+        lexer = std::make_unique<parser::lexer>(source, parser::lexer::mode::streaming);
+        parser = std::make_unique<parser::parser>(lexer.get());
+    } else {
+        {
+            support::scoped_timer scope(timer, "lex", "bytes", source.size());
+            lexer = std::make_unique<parser::lexer>(source);
+        }
+        auto tokens = lexer->take_tokens();
+        support::scoped_timer scope(timer, "parse", "tokens", tokens.size());
+        parser = std::make_unique<parser::parser>(std::move(tokens), source, lexer->symbols());
+    }
+    if (lexer->error().has_value()) {
+        err << "lexing error : " << lexer->error().value() << std::endl;
+        return false;
+    }
     if (parser->error().has_value()) {
-        std::cerr << "parsing error : " << parser->error().value();
-        return EXIT_FAILURE;
+        err << "parsing error : " << parser->error().value() << std::endl;
+        return false;
     }
 
-    auto compiler = std::make_unique<ast::compiler>(parser->ast());
+    if (options.fold) {
+        std::unique_ptr<ast::folder> folder;
+        {
+            support::scoped_timer scope(timer, "fold", "nodes", parser->ast()->memory.object_count());
+            folder = std::make_unique<ast::folder>(parser->ast());
+        }
+        if (folder->error().has_value()) {
+            err << "constant error : " << folder->error().value() << std::endl;
+            return false;
+        }
+    }
+
+    if (options.vm || options.emit_bytecode) {
+        return interpret(parser->ast(), options, output, out, err);
+    }
+
+    auto compiler = std::make_unique<ast::compiler>(parser->ast(), options.backend);
     if (compiler->error().has_value()) {
-        std::cerr << "compiling error : " << compiler->error().value();
+        err << "compiling error : " << compiler->error().value() << std::endl;
+        return false;
+    }
+
+    if (options.peephole_report) {
+        report_peephole(compiler->peephole_reports(), out);
+    }
+
+    if (options.emit_ir) {
+        support::scoped_timer scope(timer, "dump ir", "bytes");
+        output = ir::dump(*compiler->ir_module());
+        scope.set_items(output.size());
+        return true;
+    }
+    return finish(*compiler, options, output, out, err);
+}
+
+auto build(const std::string& input,
+           const std::optional<std::string>& output,
+           const options& options,
+           std::ostream& out,
+           std::ostream& err) -> bool
+{
+    auto* timer = options.backend.timer;
+    std::optional<io::mapped_file> file;
+    {
+        support::scoped_timer scope(timer, "read", "bytes");
+        file.emplace(input);
+        scope.set_items(file->view().size());
+    }
+    if (file->error().has_value()) {
+        err << "reading error : " << file->error().value() << std::endl;
+        return false;
+    }
+
+    // The cache of an incremental build sits next to its output.
+    auto path = output.value_or(output_path(input, options));
+    std::string result;
+    bool compiled = options.incremental && !options.emit_ir && !options.emit_bytecode && !options.vm
+                        ? compile_incremental(file->view(), options, path + ".cache", result, out, err)
+                        : compile(file->view(), options, result, out, err);
+    if (!compiled) {
+        err << input << " : compilation failed" << std::endl;
+        return false;
+    }
+    if (options.run || options.vm) {
+        return true;
+    }
+
+    std::optional<std::string> error;
+    {
+        support::scoped_timer scope(timer, "write", "bytes", result.size());
+        error = io::write_file(path, result, options.elf ? 0755 : 0644);
+    }
+    if (error.has_value()) {
+        err << "writing error : " << error.value() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// One input path per line, blank lines and lines starting with '#' skipped.
+auto read_manifest(const std::string& path, std::vector<std::string>& inputs) -> std::optional<std::string>
+{
+    io::mapped_file file(path);
+    if (file.error().has_value()) {
+        return file.error();
+    }
+    auto rest = file.view();
+    while (!rest.empty()) {
+        auto end = rest.find('\n');
+        auto line = rest.substr(0, end);
+        rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+            line.remove_suffix(1);
+        }
+        if (!line.empty() && line.front() != '#') {
+            inputs.emplace_back(line);
+        }
+    }
+    return std::nullopt;
+}
+
+auto print_stats(std::size_t files, std::size_t failed, double wall, double busy) -> void
+{
+    wall = wall > 0 ? wall : 1e-9;
+    std::cout << "stats : " << files << " files, " << failed << " failed in " << wall * 1e3 << " ms, "
+              << static_cast<double>(files) / wall << " files/s, " << busy / wall << " cores utilized" << std::endl;
+}
+
+auto print_passes(const support::pass_timer& timer, pass_report report) -> void
+{
+    std::cout << (report == pass_report::json ? timer.json() : timer.table());
+}
+
+// Every input is a task of its own, functions within an input are then
+// generated on the calling thread. Each input is timed on its own, the
+// report sums them.
+auto build_all(const std::vector<std::string>& inputs, options options) -> int
+{
+    options.backend.threads = 1;
+    std::vector<build_result> results(inputs.size());
+    std::vector<support::pass_timer> timers(options.time_passes != pass_report::none ? inputs.size() : 0);
+
+    auto start = std::chrono::steady_clock::now();
+    auto cpu_start = cpu_seconds();
+    {
+        support::scheduler scheduler(options.jobs);
+        for (std::size_t i = 0; i < inputs.size(); i++) {
+            scheduler.submit([&inputs, &results, &timers, &options, i]() {
+                std::ostringstream out;
+                std::ostringstream err;
+                auto& result = results[i];
+                auto local = options;
+                local.backend.timer = timers.empty() ? nullptr : &timers[i];
+                result.ok = build(inputs[i], std::nullopt, local, out, err);
+                result.out = out.str();
+                result.err = err.str();
+            });
+        }
+        scheduler.wait();
+    }
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+    auto busy = cpu_seconds() - cpu_start;
+
+    std::size_t failed = 0;
+    for (std::size_t i = 0; i < inputs.size(); i++) {
+        const auto& result = results[i];
+        std::cout << result.out;
+        std::cerr << result.err;
+        failed += result.ok ? 0 : 1;
+    }
+
+    if (options.stats) {
+        print_stats(inputs.size(), failed, wall.count(), busy);
+    }
+    if (!timers.empty()) {
+        support::pass_timer total;
+        for (const auto& timer : timers) {
+            total.merge(timer);
+        }
+        print_passes(total, options.time_passes);
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace
+
+auto main(int argc, char* argv[]) -> int
+{
+    std::vector<std::string> inputs;
+    std::optional<std::string> output;
+    options options;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-o") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << usage;
+                return EXIT_FAILURE;
+            }
+            output = argv[++i];
+        } else if (std::strcmp(argv[i], "-j") == 0) {
+            char* end = nullptr;
+            if (i + 1 < argc) {
+                options.jobs = static_cast<unsigned int>(std::strtoul(argv[++i], &end, 10));
+            }
+            if (end == nullptr || *end != '\0') {
+                std::cerr << usage;
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--manifest") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << usage;
+                return EXIT_FAILURE;
+            }
+            if (auto error = read_manifest(argv[++i], inputs)) {
+                std::cerr << "reading error : " << error.value() << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--incremental") == 0) {
+            options.incremental = true;
+        } else if (std::strcmp(argv[i], "--stats") == 0) {
+            options.stats = true;
+        } else if (std::strcmp(argv[i], "--time-passes") == 0) {
+            options.time_passes = pass_report::table;
+        } else if (std::strcmp(argv[i], "--time-passes=json") == 0) {
+            options.time_passes = pass_report::json;
+        } else if (std::strcmp(argv[i], "--no-fold") == 0) {
+            options.fold = false;
+        } else if (std::strcmp(argv[i], "--no-peephole") == 0) {
+            options.backend.peephole = false;
+        } else if (std::strcmp(argv[i], "--peephole-report") == 0) {
+            options.peephole_report = true;
+        } else if (std::strcmp(argv[i], "--elf") == 0) {
+            options.elf = true;
+        } else if (std::strcmp(argv[i], "--run") == 0) {
+            options.run = true;
+        } else if (std::strcmp(argv[i], "--vm") == 0) {
+            options.vm = true;
+        } else if (std::strcmp(argv[i], "--tiered") == 0) {
+            options.vm = true;
+            options.tiered = true;
+        } else if (std::strcmp(argv[i], "--tier-threshold") == 0) {
+            char* end = nullptr;
+            if (i + 1 < argc) {
+                options.tiers.threshold = static_cast<std::uint32_t>(std::strtoul(argv[++i], &end, 10));
+            }
+            if (end == nullptr || *end != '\0') {
+                std::cerr << usage;
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--trace-tiers") == 0) {
+            options.trace_tiers = true;
+        } else if (std::strcmp(argv[i], "--emit-ir") == 0) {
+            options.emit_ir = true;
+        } else if (std::strcmp(argv[i], "--emit-bytecode") == 0) {
+            options.emit_bytecode = true;
+        } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+            std::cout << usage;
+            return EXIT_SUCCESS;
+        } else {
+            inputs.emplace_back(argv[i]);
+        }
+    }
+
+    if (inputs.empty() || (output.has_value() && inputs.size() > 1)) {
+        std::cerr << usage;
         return EXIT_FAILURE;
     }
 
-    std::cout << compiler->result();
-    return EXIT_SUCCESS;
+    // Code run in this process reports failing divisions instead of trapping.
+    options.backend.checked_division = options.run;
+    if (inputs.size() > 1) {
+        return build_all(inputs, options);
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto cpu_start = cpu_seconds();
+    options.backend.threads = options.jobs;
+    support::pass_timer timer;
+    if (options.time_passes != pass_report::none) {
+        options.backend.timer = &timer;
+    }
+    bool ok = build(inputs.front(), output, options, std::cout, std::cerr);
+    if (options.stats) {
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+        print_stats(1, ok ? 0 : 1, wall.count(), cpu_seconds() - cpu_start);
+    }
+    if (options.time_passes != pass_report::none) {
+        print_passes(timer, options.time_passes);
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
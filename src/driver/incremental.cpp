@@ -0,0 +1,501 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <ast/compiler.hpp>
+#include <ast/folder.hpp>
+#include <driver/incremental.hpp>
+#include <parser/lexer.hpp>
+#include <parser/parser.hpp>
+#include <support/timer.hpp>
+
+namespace {
+
+using namespace monoa;
+
+// Bumped whenever code generation changes, caches from other versions are
+// then ignored.
+constexpr std::uint64_t cache_version = 1;
+constexpr char cache_magic[8] = {'m', 'o', 'n', 'o', 'a', 'c', 'c', 'h'};
+
+static_assert(std::is_trivially_copyable_v<backend::machine_record>, "records are cached as raw bytes");
+
+constexpr std::uint64_t fnv_offset = 0xcbf29ce484222325;
+constexpr std::uint64_t fnv_prime = 0x100000001b3;
+
+auto mix(std::uint64_t hash, const void* data, std::size_t size) -> std::uint64_t
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * fnv_prime;
+    }
+    return hash;
+}
+
+template <typename T> auto mix(std::uint64_t hash, T value) -> std::uint64_t
+{
+    return mix(hash, &value, sizeof(value));
+}
+
+template <typename T> auto put(std::string& out, T value) -> void
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+auto put_string(std::string& out, std::string_view text) -> void
+{
+    put(out, static_cast<std::uint64_t>(text.size()));
+    out += text;
+}
+
+// Reads back what put wrote, failing once anything would run past the end.
+class reader
+{
+public:
+    reader(std::string_view data) : data(data)
+    {
+    }
+
+    template <typename T> auto get(T& value) -> bool
+    {
+        if (this->data.size() < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, this->data.data(), sizeof(T));
+        this->data.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    auto get_bytes(std::string_view& bytes, std::uint64_t size) -> bool
+    {
+        if (this->data.size() < size) {
+            return false;
+        }
+        bytes = this->data.substr(0, size);
+        this->data.remove_prefix(size);
+        return true;
+    }
+
+    auto get_string(std::string_view& text) -> bool
+    {
+        std::uint64_t size = 0;
+        return this->get(size) && this->get_bytes(text, size);
+    }
+
+    auto at_end() -> bool
+    {
+        return this->data.empty();
+    }
+
+private:
+    std::string_view data;
+};
+
+// An entry holds the functions of one span: a peephole report for each, then
+// either the text of them all, or the symbols and records of each.
+auto encode_entry(const backend::emitted_function* functions, std::size_t count, bool text) -> std::string
+{
+    std::string out;
+    put(out, static_cast<std::uint64_t>(count));
+    for (std::size_t i = 0; i < count; i++) {
+        const auto& report = functions[i].report;
+        put_string(out, report.function);
+        put(out, static_cast<std::uint64_t>(report.before));
+        put(out, static_cast<std::uint64_t>(report.after));
+    }
+    if (text) {
+        backend::assembly program;
+        for (std::size_t i = 0; i < count; i++) {
+            backend::append_function(functions[i], program);
+        }
+        std::string rendered;
+        program.render(rendered);
+        put_string(out, rendered);
+        return out;
+    }
+    for (std::size_t i = 0; i < count; i++) {
+        const auto& function = functions[i];
+        put(out, static_cast<std::uint64_t>(function.symbols.size()));
+        for (const auto& symbol : function.symbols) {
+            put_string(out, symbol);
+        }
+        auto bytes = function.records.size() * sizeof(backend::machine_record);
+        put_string(out, std::string_view(reinterpret_cast<const char*>(function.records.data()), bytes));
+    }
+    return out;
+}
+
+// Checks an entry from the cache file, optionally taking its content out.
+// Entries are all checked on load, so that they decode fine afterwards.
+auto decode_entry(std::string_view entry,
+                  bool text,
+                  std::vector<backend::peephole_report>* reports,
+                  std::string* text_out,
+                  std::vector<backend::emitted_function>* functions) -> bool
+{
+    reader in(entry);
+    std::uint64_t count = 0;
+    if (!in.get(count)) {
+        return false;
+    }
+    for (std::uint64_t i = 0; i < count; i++) {
+        std::string_view name;
+        std::uint64_t before = 0;
+        std::uint64_t after = 0;
+        if (!in.get_string(name) || !in.get(before) || !in.get(after)) {
+            return false;
+        }
+        if (reports != nullptr) {
+            reports->push_back(backend::peephole_report{std::string(name), before, after});
+        }
+    }
+    if (text) {
+        std::string_view rendered;
+        if (!in.get_string(rendered)) {
+            return false;
+        }
+        if (text_out != nullptr) {
+            text_out->append(rendered);
+        }
+        return in.at_end();
+    }
+    for (std::uint64_t i = 0; i < count; i++) {
+        std::uint64_t symbol_count = 0;
+        if (!in.get(symbol_count)) {
+            return false;
+        }
+        auto* function = functions != nullptr ? &functions->emplace_back() : nullptr;
+        for (std::uint64_t j = 0; j < symbol_count; j++) {
+            std::string_view symbol;
+            if (!in.get_string(symbol)) {
+                return false;
+            }
+            if (function != nullptr) {
+                function->symbols.emplace_back(symbol);
+            }
+        }
+        std::string_view records;
+        if (!in.get_string(records) || records.size() % sizeof(backend::machine_record) != 0) {
+            return false;
+        }
+        if (function != nullptr) {
+            function->records.resize(records.size() / sizeof(backend::machine_record));
+            std::memcpy(function->records.data(), records.data(), records.size());
+            if (reports != nullptr) {
+                function->report = (*reports)[reports->size() - count + i];
+            }
+        }
+    }
+    return in.at_end();
+}
+
+} // namespace
+
+namespace monoa::driver {
+
+incremental::incremental(
+    std::string_view source, std::string cache_path, bool fold, bool text, backend::options options)
+    : cache_path(std::move(cache_path)), fold(fold), text(text), settings(options), source(source)
+{
+    std::unique_ptr<parser::lexer> lexer;
+    {
+        support::scoped_timer timer(this->settings.timer, "lex", "bytes", source.size());
+        lexer = std::make_unique<parser::lexer>(source);
+    }
+    if (lexer->error().has_value()) {
+        this->error_string = "lexing error : " + lexer->error().value();
+        return;
+    }
+    this->tokens = lexer->take_tokens();
+    this->symbols = lexer->take_symbols();
+    {
+        support::scoped_timer timer(this->settings.timer, "split", "tokens", this->tokens.size());
+        this->split();
+    }
+    this->load_cache();
+    this->build();
+}
+
+auto incremental::result() -> std::string
+{
+    return this->backend.has_value() ? this->backend->result() : this->text_result;
+}
+
+auto incremental::error() -> std::optional<std::string>
+{
+    return this->error_string;
+}
+
+auto incremental::peephole_reports() -> const std::vector<backend::peephole_report>&
+{
+    return this->backend.has_value() ? this->backend->peephole_reports() : this->reports;
+}
+
+auto incremental::program() -> const backend::assembly&
+{
+    static const backend::assembly none;
+    return this->backend.has_value() ? this->backend->program() : none;
+}
+
+auto incremental::reused() -> std::size_t
+{
+    return this->reused_count;
+}
+
+auto incremental::compiled() -> std::size_t
+{
+    return this->compiled_count;
+}
+
+// A function runs from `fun` to the brace closing its body. Function hashes
+// take in every top-level statement before them, since a function can read
+// the variables they declare.
+auto incremental::split() -> void
+{
+    auto token_count = this->tokens.size();
+    std::uint64_t context = fnv_offset;
+    std::size_t i = 0;
+    while (i < token_count) {
+        span next{i, i, this->tokens[i].type == parser::token::type::key_fun, 0};
+        if (next.function) {
+            int depth = 0;
+            for (; i < token_count; i++) {
+                auto type = this->tokens[i].type;
+                if (type == parser::token::type::puc_left_brace) {
+                    depth++;
+                } else if (type == parser::token::type::puc_right_brace && --depth == 0) {
+                    i++;
+                    break;
+                }
+            }
+        } else {
+            while (i < token_count && this->tokens[i].type != parser::token::type::key_fun) {
+                i++;
+            }
+        }
+        next.end = i;
+
+        std::uint64_t hash = next.function ? context : fnv_offset;
+        for (auto j = next.begin; j < next.end; j++) {
+            const auto& token = this->tokens[j];
+            hash = mix(hash, static_cast<std::uint8_t>(token.type));
+            auto lexeme = token.lexeme(this->source);
+            hash = mix(hash, lexeme.data(), lexeme.size());
+            hash = mix(hash, static_cast<std::uint8_t>(0xff));
+        }
+        next.hash = hash;
+        if (!next.function) {
+            context = mix(context, hash);
+        }
+        this->spans.push_back(next);
+    }
+}
+
+auto incremental::settings_hash() -> std::uint64_t
+{
+    std::uint64_t hash = mix(fnv_offset, cache_version);
+    hash = mix(hash, static_cast<std::uint64_t>(sizeof(backend::machine_record)));
+    hash = mix(hash, this->fold);
+    hash = mix(hash, this->text);
+    hash = mix(hash, this->settings.checked_division);
+    return mix(hash, this->settings.peephole);
+}
+
+// The file is a header, an index of hashes with the offset and size of their
+// entry, then the entries. A cache that is missing, stale or damaged is the
+// same as an empty one.
+auto incremental::load_cache() -> void
+{
+    support::scoped_timer timer(this->settings.timer, "cache read", "bytes");
+    this->cache_file = std::make_unique<io::mapped_file>(this->cache_path);
+    if (this->cache_file->error().has_value()) {
+        return;
+    }
+    timer.set_items(this->cache_file->view().size());
+    reader in(this->cache_file->view());
+    char magic[sizeof(cache_magic)];
+    std::uint64_t settings = 0;
+    std::uint64_t entry_count = 0;
+    if (!in.get(magic) || std::memcmp(magic, cache_magic, sizeof(magic)) != 0 || !in.get(settings) ||
+        settings != this->settings_hash() || !in.get(entry_count)) {
+        return;
+    }
+
+    std::string_view index;
+    std::string_view entries;
+    if (entry_count > this->cache_file->view().size() / 24 || !in.get_bytes(index, entry_count * 24) ||
+        !in.get_string(entries) || !in.at_end()) {
+        return;
+    }
+    reader index_in(index);
+    for (std::uint64_t i = 0; i < entry_count; i++) {
+        std::uint64_t hash = 0;
+        std::uint64_t offset = 0;
+        std::uint64_t size = 0;
+        index_in.get(hash);
+        index_in.get(offset);
+        index_in.get(size);
+        if (offset > entries.size() || size > entries.size() - offset ||
+            !decode_entry(entries.substr(offset, size), this->text, nullptr, nullptr, nullptr)) {
+            this->cache.clear();
+            return;
+        }
+        this->cache.emplace(hash, entries.substr(offset, size));
+    }
+}
+
+// Changed functions are compiled together with every top-level statement, in
+// source order, so that they see the same variables as in a full build.
+auto incremental::compile_changed(std::vector<bool>& changed)
+    -> std::optional<std::vector<backend::emitted_function>>
+{
+    std::vector<parser::token> stream;
+    std::size_t expected = 0;
+    for (std::size_t index = 0; index < this->spans.size(); index++) {
+        const auto& span = this->spans[index];
+        if (span.function && this->cache.count(span.hash) > 0) {
+            this->reused_count++;
+            continue;
+        }
+        changed[index] = span.function;
+        this->compiled_count += span.function ? 1 : 0;
+        for (auto i = span.begin; i < span.end; i++) {
+            expected += span.function && this->tokens[i].type == parser::token::type::key_fun ? 1 : 0;
+        }
+        stream.insert(stream.end(), this->tokens.begin() + span.begin, this->tokens.begin() + span.end);
+    }
+    if (stream.empty()) {
+        return std::vector<backend::emitted_function>();
+    }
+
+    // The parser never consumes the last token, keep the file's own last
+    // token there so the last changed function parses as in a full build.
+    if (this->spans.back().function && !changed.back()) {
+        stream.push_back(this->tokens.back());
+    }
+    std::unique_ptr<parser::parser> parser;
+    {
+        support::scoped_timer timer(this->settings.timer, "parse", "tokens", stream.size());
+        parser = std::make_unique<parser::parser>(std::move(stream), this->source, &this->symbols);
+    }
+    if (parser->error().has_value()) {
+        this->error_string = "parsing error : " + parser->error().value();
+        return std::nullopt;
+    }
+    if (this->fold) {
+        std::unique_ptr<ast::folder> folder;
+        {
+            support::scoped_timer timer(this->settings.timer, "fold", "nodes", parser->ast()->memory.object_count());
+            folder = std::make_unique<ast::folder>(parser->ast());
+        }
+        if (folder->error().has_value()) {
+            this->error_string = "constant error : " + folder->error().value();
+            return std::nullopt;
+        }
+    }
+    ast::compiler compiler(parser->ast(), this->settings);
+    if (compiler.error().has_value()) {
+        this->error_string = "compiling error : " + compiler.error().value();
+        return std::nullopt;
+    }
+    if (compiler.functions().size() != expected) {
+        this->error_string = "compiling error : changed functions do not match their source";
+        return std::nullopt;
+    }
+    return compiler.functions();
+}
+
+auto incremental::build() -> void
+{
+    std::vector<bool> changed(this->spans.size(), false);
+    auto fresh = this->compile_changed(changed);
+    if (!fresh.has_value()) {
+        return;
+    }
+
+    std::vector<backend::emitted_function> functions;
+    if (this->text) {
+        this->text_result = backend::x86(std::vector<backend::emitted_function>(), this->settings).result();
+    }
+
+    // Entries of this build in order of first use, to write the next cache.
+    std::unordered_map<std::uint64_t, std::string> fresh_entries;
+    std::vector<std::pair<std::uint64_t, std::string_view>> entries;
+    std::unordered_map<std::uint64_t, bool> written;
+    auto next_fresh = fresh->data();
+    for (std::size_t index = 0; index < this->spans.size(); index++) {
+        const auto& span = this->spans[index];
+        if (!span.function) {
+            continue;
+        }
+        std::string_view entry;
+        if (changed[index]) {
+            std::size_t count = 0;
+            for (auto i = span.begin; i < span.end; i++) {
+                count += this->tokens[i].type == parser::token::type::key_fun ? 1 : 0;
+            }
+            // Identical spans compile to the same code, the first encoding
+            // serves them all and is never reassigned while viewed.
+            auto [encoded, inserted] = fresh_entries.try_emplace(span.hash);
+            if (inserted) {
+                encoded->second = encode_entry(next_fresh, count, this->text);
+            }
+            next_fresh += count;
+            entry = encoded->second;
+        } else {
+            entry = this->cache[span.hash];
+        }
+        decode_entry(entry, this->text, &this->reports, &this->text_result, &functions);
+        if (!written[span.hash]) {
+            written[span.hash] = true;
+            entries.emplace_back(span.hash, entry);
+        }
+    }
+    if (!this->text) {
+        this->backend.emplace(std::move(functions), this->settings);
+    }
+
+    if (this->compiled_count == 0 && entries.size() == this->cache.size()) {
+        return;
+    }
+    std::string out;
+    out.append(cache_magic, sizeof(cache_magic));
+    put(out, this->settings_hash());
+    put(out, static_cast<std::uint64_t>(entries.size()));
+    std::uint64_t offset = 0;
+    for (const auto& [hash, entry] : entries) {
+        put(out, hash);
+        put(out, offset);
+        put(out, static_cast<std::uint64_t>(entry.size()));
+        offset += entry.size();
+    }
+    put(out, offset);
+    for (const auto& entry : entries) {
+        out += entry.second;
+    }
+    // Entries point into the mapped file, which is about to be replaced.
+    this->cache.clear();
+    this->cache_file.reset();
+    // The cache only saves time, failing to write it fails nothing.
+    support::scoped_timer timer(this->settings.timer, "cache write", "bytes", out.size());
+    io::write_file(this->cache_path, out);
+}
+
+} // namespace monoa::driver
@@ -0,0 +1,101 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_DRIVER_INCREMENTAL_HPP
+#define MONOA_DRIVER_INCREMENTAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <backend/x86.hpp>
+#include <io/file.hpp>
+#include <parser/token.hpp>
+#include <support/interner.hpp>
+
+namespace monoa::driver {
+
+// Compiles a source file reusing the code of every top-level function whose
+// tokens, and the top-level statements before it, are unchanged since the
+// cache was written. Only the changed functions are parsed and compiled, then
+// everything is put together in source order and the cache rewritten for the
+// next build. For text output the cache keeps the text of each function, so
+// that unchanged ones are copied as they are, otherwise it keeps their
+// records to be linked again.
+class incremental
+{
+public:
+    incremental(std::string_view source,
+                std::string cache_path,
+                bool fold,
+                bool text,
+                backend::options options = {});
+    auto result() -> std::string;
+    auto error() -> std::optional<std::string>;
+    auto peephole_reports() -> const std::vector<backend::peephole_report>&;
+    auto program() -> const backend::assembly&;
+    // Top-level functions taken from the cache, and compiled again.
+    auto reused() -> std::size_t;
+    auto compiled() -> std::size_t;
+
+private:
+    // Tokens of a top-level function, or of the statements between two of
+    // them, which every later function may depend on.
+    struct span
+    {
+        std::size_t begin;
+        std::size_t end;
+        bool function;
+        std::uint64_t hash;
+    };
+
+    std::optional<std::string> error_string;
+    std::string cache_path;
+    bool fold;
+    bool text;
+    backend::options settings;
+    std::size_t reused_count = 0;
+    std::size_t compiled_count = 0;
+
+    // The caller's source, tokens refer into it.
+    std::string_view source;
+    std::vector<parser::token> tokens;
+    support::interner symbols;
+    std::vector<span> spans;
+    // Cache entries by span hash, they point into the mapped cache file.
+    std::unique_ptr<io::mapped_file> cache_file;
+    std::unordered_map<std::uint64_t, std::string_view> cache;
+
+    std::string text_result;
+    std::vector<backend::peephole_report> reports;
+    std::optional<backend::x86> backend;
+
+    auto split() -> void;
+    auto settings_hash() -> std::uint64_t;
+    auto load_cache() -> void;
+    auto compile_changed(std::vector<bool>& changed) -> std::optional<std::vector<backend::emitted_function>>;
+    auto build() -> void;
+};
+
+} // namespace monoa::driver
+
+#endif // MONOA_DRIVER_INCREMENTAL_HPP
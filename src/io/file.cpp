@@ -0,0 +1,117 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <io/file.hpp>
+
+namespace monoa::io {
+
+mapped_file::mapped_file(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        this->error_string = path + " : " + std::strerror(errno);
+        return;
+    }
+
+    struct stat info = {};
+    if (::fstat(fd, &info) < 0) {
+        this->error_string = path + " : " + std::strerror(errno);
+        ::close(fd);
+        return;
+    }
+
+    this->length = static_cast<std::size_t>(info.st_size);
+    if (this->length > 0) {
+        void* data = ::mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            this->error_string = path + " : " + std::strerror(errno);
+            this->length = 0;
+        } else {
+            this->data = data;
+            ::madvise(this->data, this->length, MADV_SEQUENTIAL);
+        }
+    }
+    ::close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+    if (this->data != nullptr) {
+        ::munmap(this->data, this->length);
+    }
+}
+
+auto mapped_file::view() -> std::string_view
+{
+    return {static_cast<const char*>(this->data), this->length};
+}
+
+auto mapped_file::error() -> std::optional<std::string>
+{
+    return this->error_string;
+}
+
+auto write_file(const std::string& path, std::string_view content, unsigned int mode) -> std::optional<std::string>
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (fd < 0) {
+        return path + " : " + std::strerror(errno);
+    }
+    // open(2) applies the mode, less the umask, only to files it creates. An
+    // executable replacing a file that is not gets to execute where the file
+    // can be read, other permissions are left as they were.
+    struct stat info = {};
+    if ((mode & 0111) != 0 && ::fstat(fd, &info) == 0 && (info.st_mode & 0111) == 0) {
+        auto executable = ((info.st_mode & 0444) >> 2) & mode;
+        if (executable != 0 && ::fchmod(fd, (info.st_mode & 07777) | executable) < 0) {
+            std::string message = path + " : " + std::strerror(errno);
+            ::close(fd);
+            return message;
+        }
+    }
+
+    // write(2) may return early on large buffers, keep going until everything is out.
+    const char* data = content.data();
+    std::size_t remaining = content.size();
+    while (remaining > 0) {
+        ssize_t written = ::write(fd, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::string message = path + " : " + std::strerror(errno);
+            ::close(fd);
+            return message;
+        }
+        data += written;
+        remaining -= static_cast<std::size_t>(written);
+    }
+
+    if (::close(fd) < 0) {
+        return path + " : " + std::strerror(errno);
+    }
+    return std::nullopt;
+}
+
+} // namespace monoa::io
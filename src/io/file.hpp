@@ -0,0 +1,53 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_IO_FILE_HPP
+#define MONOA_IO_FILE_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace monoa::io {
+
+class mapped_file
+{
+public:
+    mapped_file(const std::string& path);
+    mapped_file(const mapped_file&) = delete;
+    auto operator=(const mapped_file&) -> mapped_file& = delete;
+    ~mapped_file();
+    auto view() -> std::string_view;
+    auto error() -> std::optional<std::string>;
+
+private:
+    void* data = nullptr;
+    std::size_t length = 0;
+    std::optional<std::string> error_string;
+};
+
+// Creates the file with `mode` less the umask. An existing file keeps its
+// permissions, except that an executable written over it is made executable
+// wherever it is readable.
+auto write_file(const std::string& path, std::string_view content, unsigned int mode = 0644)
+    -> std::optional<std::string>;
+
+} // namespace monoa::io
+
+#endif // MONOA_IO_FILE_HPP
@@ -0,0 +1,304 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ir/ir.hpp>
+
+namespace {
+
+using namespace monoa::ir;
+
+auto operand_string(operand value) -> std::string
+{
+    switch (value.kind) {
+    case operand::kind::constant:
+        return std::to_string(static_cast<std::int64_t>(value.data));
+    case operand::kind::value:
+        return "%" + std::to_string(value.data);
+    default:
+        return "<none>";
+    }
+}
+
+auto block_string(block_id block) -> std::string
+{
+    return "block" + std::to_string(block);
+}
+
+} // namespace
+
+namespace monoa::ir {
+
+auto operand::constant(std::uint64_t bits) -> operand
+{
+    return operand{kind::constant, bits};
+}
+
+auto operand::value(value_id id) -> operand
+{
+    return operand{kind::value, id};
+}
+
+auto operand::is_constant() const -> bool
+{
+    return this->kind == kind::constant;
+}
+
+auto operand::is_value() const -> bool
+{
+    return this->kind == kind::value;
+}
+
+auto operand::id() const -> value_id
+{
+    return static_cast<value_id>(this->data);
+}
+
+auto instruction::is_terminator() const -> bool
+{
+    return this->code == opcode::ret || this->code == opcode::jump || this->code == opcode::branch;
+}
+
+auto instruction::has_result() const -> bool
+{
+    return !this->is_terminator();
+}
+
+auto function::value_count() const -> value_id
+{
+    return static_cast<value_id>(this->value_types.size());
+}
+
+auto function::successors(block_id block) const -> std::vector<block_id>
+{
+    const auto& instructions = this->blocks[block].instructions;
+    if (instructions.empty()) {
+        return {};
+    }
+    const auto& last = instructions.back();
+    switch (last.code) {
+    case opcode::jump:
+        return {last.targets[0]};
+    case opcode::branch:
+        return {last.targets[0], last.targets[1]};
+    default:
+        return {};
+    }
+}
+
+auto function::predecessors() const -> std::vector<std::vector<block_id>>
+{
+    std::vector<std::vector<block_id>> result(this->blocks.size());
+    for (block_id block = 0; block < this->blocks.size(); block++) {
+        for (auto successor : this->successors(block)) {
+            if (successor < result.size()) {
+                result[successor].push_back(block);
+            }
+        }
+    }
+    return result;
+}
+
+builder::builder(function* target) : target(target)
+{
+    if (this->target->blocks.empty()) {
+        this->create_block();
+    }
+}
+
+auto builder::create_block() -> block_id
+{
+    this->target->blocks.emplace_back();
+    return static_cast<block_id>(this->target->blocks.size() - 1);
+}
+
+auto builder::set_block(block_id block) -> void
+{
+    this->block = block;
+}
+
+auto builder::current_block() -> block_id
+{
+    return this->block;
+}
+
+auto builder::is_terminated() -> bool
+{
+    const auto& instructions = this->target->blocks[this->block].instructions;
+    return !instructions.empty() && instructions.back().is_terminator();
+}
+
+auto builder::binary(opcode code, ast::basic_type type, operand left, operand right) -> operand
+{
+    instruction instruction{code, type};
+    instruction.left = left;
+    instruction.right = right;
+    return this->append(std::move(instruction));
+}
+
+auto builder::convert(ast::basic_type type, operand value) -> operand
+{
+    instruction instruction{opcode::convert, type};
+    instruction.left = value;
+    return this->append(std::move(instruction));
+}
+
+auto builder::phi(ast::basic_type type, std::vector<incoming> incomings) -> operand
+{
+    instruction instruction{opcode::phi, type};
+    instruction.incomings = std::move(incomings);
+    return this->append(std::move(instruction));
+}
+
+auto builder::ret(operand value) -> void
+{
+    instruction instruction{opcode::ret};
+    instruction.left = value;
+    this->append(std::move(instruction));
+}
+
+auto builder::jump(block_id target) -> void
+{
+    instruction instruction{opcode::jump};
+    instruction.targets[0] = target;
+    this->append(std::move(instruction));
+}
+
+auto builder::branch(operand condition, block_id taken, block_id not_taken) -> void
+{
+    instruction instruction{opcode::branch};
+    instruction.left = condition;
+    instruction.targets[0] = taken;
+    instruction.targets[1] = not_taken;
+    this->append(std::move(instruction));
+}
+
+auto builder::append(instruction instruction) -> operand
+{
+    operand result;
+    if (instruction.has_result()) {
+        instruction.result = this->target->value_count();
+        this->target->value_types.push_back(instruction.type);
+        result = operand::value(instruction.result);
+    }
+    this->target->blocks[this->block].instructions.push_back(std::move(instruction));
+    return result;
+}
+
+auto opcode_name(opcode code) -> const char*
+{
+    switch (code) {
+    case opcode::add:
+        return "add";
+    case opcode::sub:
+        return "sub";
+    case opcode::mul:
+        return "mul";
+    case opcode::div:
+        return "div";
+    case opcode::convert:
+        return "convert";
+    case opcode::phi:
+        return "phi";
+    case opcode::ret:
+        return "ret";
+    case opcode::jump:
+        return "jump";
+    case opcode::branch:
+        return "branch";
+    default:
+        return "unknow";
+    }
+}
+
+auto instruction_count(const module& module) -> std::size_t
+{
+    std::size_t count = 0;
+    for (const auto& function : module.functions) {
+        for (const auto& block : function.blocks) {
+            count += block.instructions.size();
+        }
+    }
+    return count;
+}
+
+auto dump(const module& module) -> std::string
+{
+    std::string text;
+    for (const auto& function : module.functions) {
+        text += dump(function);
+        text += "\n";
+    }
+    return text;
+}
+
+auto dump(const function& function) -> std::string
+{
+    std::string text = "function " + function.name + "\n";
+    auto predecessors = function.predecessors();
+
+    for (block_id block = 0; block < function.blocks.size(); block++) {
+        text += block_string(block) + ":";
+        if (!predecessors[block].empty()) {
+            text += " ; preds:";
+            for (auto predecessor : predecessors[block]) {
+                text += " " + block_string(predecessor);
+            }
+        }
+        text += "\n";
+
+        for (const auto& instruction : function.blocks[block].instructions) {
+            text += "    ";
+            if (instruction.has_result()) {
+                text += "%" + std::to_string(instruction.result) + " = ";
+            }
+            text += opcode_name(instruction.code);
+            if (instruction.has_result()) {
+                text += std::string(" ") + ast::type_name(instruction.type);
+            }
+
+            switch (instruction.code) {
+            case opcode::phi:
+                for (std::size_t i = 0; i < instruction.incomings.size(); i++) {
+                    const auto& incoming = instruction.incomings[i];
+                    text += i == 0 ? " [" : ", [";
+                    text += operand_string(incoming.value) + ", " + block_string(incoming.block) + "]";
+                }
+                break;
+            case opcode::convert:
+            case opcode::ret:
+                text += " " + operand_string(instruction.left);
+                break;
+            case opcode::jump:
+                text += " " + block_string(instruction.targets[0]);
+                break;
+            case opcode::branch:
+                text += " " + operand_string(instruction.left) + ", " +
+                        block_string(instruction.targets[0]) + ", " + block_string(instruction.targets[1]);
+                break;
+            default:
+                text += " " + operand_string(instruction.left) + ", " +
+                        operand_string(instruction.right);
+                break;
+            }
+            text += "\n";
+        }
+    }
+    return text;
+}
+
+} // namespace monoa::ir
@@ -0,0 +1,148 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_IR_IR_HPP
+#define MONOA_IR_IR_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include <ast/ast.hpp>
+
+namespace monoa::ir {
+
+using value_id = std::uint32_t;
+using block_id = std::uint32_t;
+
+struct operand
+{
+    enum class kind : std::uint8_t
+    {
+        none,
+        constant,
+        value,
+    };
+
+    kind kind = kind::none;
+    std::uint64_t data = 0;
+
+    static auto constant(std::uint64_t bits) -> operand;
+    static auto value(value_id id) -> operand;
+    auto is_constant() const -> bool;
+    auto is_value() const -> bool;
+    auto id() const -> value_id;
+};
+
+enum class opcode : std::uint8_t
+{
+    add,
+    sub,
+    mul,
+    div,
+    // Converts between integer widths, left is the source.
+    convert,
+    // Takes the value incoming from the predecessor control came from.
+    phi,
+
+    // Terminators, exactly one ends every block.
+    ret,
+    jump,
+    branch,
+};
+
+struct incoming
+{
+    block_id block;
+    operand value;
+};
+
+// Every instruction producing a value defines `result` exactly once, with the
+// width and signedness given by `type`. Constant operands take the type of the
+// instruction they appear in.
+struct instruction
+{
+    opcode code;
+    ast::basic_type type = ast::basic_type::unknow;
+    value_id result = 0;
+    operand left = {};
+    operand right = {};
+    // Jump target, or the taken and not taken targets of a branch.
+    block_id targets[2] = {0, 0};
+    // Phi operands, one per predecessor.
+    std::vector<incoming> incomings = {};
+
+    auto is_terminator() const -> bool;
+    auto has_result() const -> bool;
+};
+
+struct basic_block
+{
+    std::vector<instruction> instructions;
+};
+
+struct function
+{
+    std::string name;
+    std::vector<basic_block> blocks;
+    std::vector<ast::basic_type> value_types;
+
+    auto value_count() const -> value_id;
+    auto successors(block_id block) const -> std::vector<block_id>;
+    auto predecessors() const -> std::vector<std::vector<block_id>>;
+};
+
+struct module
+{
+    std::vector<function> functions;
+};
+
+// Appends instructions at the end of the current block of a function.
+class builder
+{
+public:
+    builder(function* target);
+    auto create_block() -> block_id;
+    auto set_block(block_id block) -> void;
+    auto current_block() -> block_id;
+    auto is_terminated() -> bool;
+
+    auto binary(opcode code, ast::basic_type type, operand left, operand right) -> operand;
+    auto convert(ast::basic_type type, operand value) -> operand;
+    auto phi(ast::basic_type type, std::vector<incoming> incomings) -> operand;
+    auto ret(operand value) -> void;
+    auto jump(block_id target) -> void;
+    auto branch(operand condition, block_id taken, block_id not_taken) -> void;
+
+private:
+    function* target;
+    block_id block = 0;
+
+    auto append(instruction instruction) -> operand;
+};
+
+auto opcode_name(opcode code) -> const char*;
+auto dump(const module& module) -> std::string;
+auto dump(const function& function) -> std::string;
+auto verify(const module& module) -> std::optional<std::string>;
+auto verify(const function& function) -> std::optional<std::string>;
+auto instruction_count(const module& module) -> std::size_t;
+
+} // namespace monoa::ir
+
+#endif // MONOA_IR_IR_HPP
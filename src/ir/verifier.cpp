@@ -0,0 +1,274 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ir/ir.hpp>
+
+namespace {
+
+using namespace monoa::ir;
+
+struct definition
+{
+    block_id block;
+    std::size_t index;
+};
+
+// Dominator sets by the classic iterative data flow, functions are small.
+// Blocks without predecessors other than the entry are unreachable, they are
+// left dominated by every block so that dead code after a ret still verifies.
+auto dominators(const function& function, const std::vector<std::vector<block_id>>& predecessors)
+    -> std::vector<std::vector<bool>>
+{
+    auto count = function.blocks.size();
+    std::vector<std::vector<bool>> result(count, std::vector<bool>(count, true));
+    result[0].assign(count, false);
+    result[0][0] = true;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (block_id block = 1; block < count; block++) {
+            if (predecessors[block].empty()) {
+                continue;
+            }
+            std::vector<bool> set(count, true);
+            for (auto predecessor : predecessors[block]) {
+                for (std::size_t i = 0; i < count; i++) {
+                    set[i] = set[i] && result[predecessor][i];
+                }
+            }
+            set[block] = true;
+            if (set != result[block]) {
+                result[block] = std::move(set);
+                changed = true;
+            }
+        }
+    }
+    return result;
+}
+
+class verifier
+{
+public:
+    verifier(const function& function) : target(function)
+    {
+    }
+
+    auto run() -> std::optional<std::string>
+    {
+        if (this->target.blocks.empty()) {
+            return this->fail("has no block");
+        }
+        if (auto error = this->check_structure()) {
+            return error;
+        }
+        if (auto error = this->collect_definitions()) {
+            return error;
+        }
+        this->predecessors = this->target.predecessors();
+        this->dominance = dominators(this->target, this->predecessors);
+
+        for (block_id block = 0; block < this->target.blocks.size(); block++) {
+            const auto& instructions = this->target.blocks[block].instructions;
+            for (std::size_t index = 0; index < instructions.size(); index++) {
+                if (auto error = this->check_instruction(block, index, instructions[index])) {
+                    return error;
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    const function& target;
+    std::vector<std::optional<definition>> definitions;
+    std::vector<std::vector<block_id>> predecessors;
+    std::vector<std::vector<bool>> dominance;
+
+    auto fail(const std::string& message) -> std::optional<std::string>
+    {
+        return "function " + this->target.name + " : " + message;
+    }
+
+    auto fail(block_id block, std::size_t index, const std::string& message) -> std::optional<std::string>
+    {
+        return this->fail("block" + std::to_string(block) + "[" + std::to_string(index) + "] : " + message);
+    }
+
+    auto check_structure() -> std::optional<std::string>
+    {
+        for (block_id block = 0; block < this->target.blocks.size(); block++) {
+            const auto& instructions = this->target.blocks[block].instructions;
+            if (instructions.empty() || !instructions.back().is_terminator()) {
+                return this->fail("block" + std::to_string(block) + " does not end with a terminator");
+            }
+            bool leading_phis = true;
+            for (std::size_t index = 0; index < instructions.size(); index++) {
+                const auto& instruction = instructions[index];
+                if (instruction.is_terminator() && index + 1 != instructions.size()) {
+                    return this->fail(block, index, "terminator in the middle of a block");
+                }
+                if (instruction.code == opcode::phi && !leading_phis) {
+                    return this->fail(block, index, "phi after a non phi instruction");
+                }
+                leading_phis = leading_phis && instruction.code == opcode::phi;
+                for (std::size_t i = 0; instruction.is_terminator() && i < 2; i++) {
+                    if (instruction.targets[i] >= this->target.blocks.size()) {
+                        return this->fail(block, index, "jump to an unknown block");
+                    }
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    auto collect_definitions() -> std::optional<std::string>
+    {
+        this->definitions.assign(this->target.value_count(), std::nullopt);
+        for (block_id block = 0; block < this->target.blocks.size(); block++) {
+            const auto& instructions = this->target.blocks[block].instructions;
+            for (std::size_t index = 0; index < instructions.size(); index++) {
+                const auto& instruction = instructions[index];
+                if (!instruction.has_result()) {
+                    continue;
+                }
+                if (instruction.result >= this->target.value_count()) {
+                    return this->fail(block, index, "result out of range");
+                }
+                if (this->definitions[instruction.result].has_value()) {
+                    return this->fail(block, index, "%" + std::to_string(instruction.result) + " defined twice");
+                }
+                if (this->target.value_types[instruction.result] != instruction.type) {
+                    return this->fail(block, index, "result type differs from the value type");
+                }
+                if (instruction.type == monoa::ast::basic_type::unknow) {
+                    return this->fail(block, index, "result has no type");
+                }
+                this->definitions[instruction.result] = definition{block, index};
+            }
+        }
+        return std::nullopt;
+    }
+
+    // A use at (block, index) must be dominated by the definition of the value.
+    auto check_use(block_id block, std::size_t index, operand value) -> std::optional<std::string>
+    {
+        if (!value.is_value()) {
+            return std::nullopt;
+        }
+        if (value.id() >= this->target.value_count() || !this->definitions[value.id()].has_value()) {
+            return this->fail(block, index, "use of undefined %" + std::to_string(value.data));
+        }
+        auto def = this->definitions[value.id()].value();
+        bool dominated = def.block == block ? def.index < index : this->dominance[block][def.block];
+        if (!dominated) {
+            return this->fail(block, index, "%" + std::to_string(value.data) + " does not dominate its use");
+        }
+        return std::nullopt;
+    }
+
+    auto check_type(block_id block, std::size_t index, const instruction& instruction, operand value)
+        -> std::optional<std::string>
+    {
+        if (value.is_value() && this->target.value_types[value.id()] != instruction.type) {
+            return this->fail(block, index, "operand type differs from the instruction type");
+        }
+        return std::nullopt;
+    }
+
+    auto check_instruction(block_id block, std::size_t index, const instruction& instruction)
+        -> std::optional<std::string>
+    {
+        switch (instruction.code) {
+        case opcode::add:
+        case opcode::sub:
+        case opcode::mul:
+        case opcode::div:
+            for (auto value : {instruction.left, instruction.right}) {
+                if (value.kind == operand::kind::none) {
+                    return this->fail(block, index, "missing operand");
+                }
+                if (auto error = this->check_use(block, index, value)) {
+                    return error;
+                }
+                if (auto error = this->check_type(block, index, instruction, value)) {
+                    return error;
+                }
+            }
+            return std::nullopt;
+        case opcode::convert:
+        case opcode::ret:
+        case opcode::branch:
+            if (instruction.left.kind == operand::kind::none) {
+                return this->fail(block, index, "missing operand");
+            }
+            return this->check_use(block, index, instruction.left);
+        case opcode::phi:
+            return this->check_phi(block, index, instruction);
+        default:
+            return std::nullopt;
+        }
+    }
+
+    // Phi operands are used at the end of their predecessor, not in the phi block.
+    auto check_phi(block_id block, std::size_t index, const instruction& instruction) -> std::optional<std::string>
+    {
+        const auto& expected = this->predecessors[block];
+        if (instruction.incomings.size() != expected.size()) {
+            return this->fail(block, index, "phi does not have one operand per predecessor");
+        }
+        for (const auto& incoming : instruction.incomings) {
+            bool known = false;
+            for (auto predecessor : expected) {
+                known = known || predecessor == incoming.block;
+            }
+            if (!known) {
+                return this->fail(block, index, "phi operand from a block that is not a predecessor");
+            }
+            auto end = this->target.blocks[incoming.block].instructions.size();
+            if (auto error = this->check_use(incoming.block, end, incoming.value)) {
+                return error;
+            }
+            if (auto error = this->check_type(block, index, instruction, incoming.value)) {
+                return error;
+            }
+        }
+        return std::nullopt;
+    }
+};
+
+} // namespace
+
+namespace monoa::ir {
+
+auto verify(const module& module) -> std::optional<std::string>
+{
+    for (const auto& function : module.functions) {
+        if (auto error = verify(function)) {
+            return error;
+        }
+    }
+    return std::nullopt;
+}
+
+auto verify(const function& function) -> std::optional<std::string>
+{
+    return verifier(function).run();
+}
+
+} // namespace monoa::ir
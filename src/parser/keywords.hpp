@@ -0,0 +1,184 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_PARSER_KEYWORDS_HPP
+#define MONOA_PARSER_KEYWORDS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <parser/token.hpp>
+
+namespace monoa::parser::keywords {
+
+struct entry
+{
+    std::string_view spelling;
+    enum token::type type;
+};
+
+// Every token with a fixed spelling, the lexer recognizes keywords and operators
+// from this table only, adding one is a matter of adding a line here.
+inline constexpr entry entries[] = {
+    {"(", token::type::puc_left_paren},
+    {")", token::type::puc_right_paren},
+    {"{", token::type::puc_left_brace},
+    {"}", token::type::puc_right_brace},
+    {".", token::type::puc_dot},
+    {",", token::type::puc_comma},
+    {":", token::type::puc_colon},
+    {";", token::type::puc_semi_colon},
+
+    {"+", token::type::opt_plus},
+    {"-", token::type::opt_minus},
+    {"*", token::type::opt_star},
+    {"/", token::type::opt_slash},
+    {"+=", token::type::opt_plus_equal},
+    {"-=", token::type::opt_minus_equal},
+
+    {"=", token::type::opt_equal},
+    {"==", token::type::opt_equal_equal},
+    {"!", token::type::opt_bang},
+    {"!=", token::type::opt_bang_equal},
+    {">", token::type::opt_greater},
+    {">=", token::type::opt_greater_equal},
+    {"<", token::type::opt_lesser},
+    {"<=", token::type::opt_lesser_equal},
+
+    {"->", token::type::opt_return},
+
+    {"int", token::type::typ_int},
+    {"dec", token::type::typ_dec},
+    {"string", token::type::typ_string},
+
+    {"if", token::type::key_if},
+    {"else", token::type::key_else},
+    {"for", token::type::key_for},
+    {"let", token::type::key_let},
+    {"fun", token::type::key_fun},
+    {"return", token::type::key_return},
+};
+
+inline constexpr std::size_t entry_count = sizeof(entries) / sizeof(entries[0]);
+
+constexpr auto longest_operator() -> std::size_t
+{
+    std::size_t longest = 0;
+    for (const entry& e : entries) {
+        bool is_word = (e.spelling[0] >= 'a' && e.spelling[0] <= 'z') || (e.spelling[0] >= 'A' && e.spelling[0] <= 'Z');
+        if (!is_word && e.spelling.size() > longest) {
+            longest = e.spelling.size();
+        }
+    }
+    return longest;
+}
+
+inline constexpr std::size_t max_operator_length = longest_operator();
+
+// Perfect hash over the first, middle and last characters plus the length,
+// the multiplier is searched at compile time so that no two entries share a slot.
+
+constexpr auto table_bits() -> unsigned int
+{
+    unsigned int bits = 1;
+    while ((std::size_t{1} << bits) < entry_count * 4) {
+        bits++;
+    }
+    return bits;
+}
+
+inline constexpr unsigned int hash_bits = table_bits();
+inline constexpr std::size_t table_size = std::size_t{1} << hash_bits;
+
+constexpr auto hash(std::string_view word, std::uint32_t seed) -> std::uint32_t
+{
+    auto key = static_cast<std::uint32_t>(static_cast<unsigned char>(word[0])) |
+               static_cast<std::uint32_t>(static_cast<unsigned char>(word[word.size() / 2])) << 8 |
+               static_cast<std::uint32_t>(static_cast<unsigned char>(word[word.size() - 1])) << 16 |
+               static_cast<std::uint32_t>(word.size()) << 24;
+    return (key * seed) >> (32 - hash_bits);
+}
+
+struct table
+{
+    std::uint32_t seed = 0;
+    std::array<std::uint8_t, table_size> slots = {};
+};
+
+constexpr std::uint8_t empty_slot = 0xff;
+static_assert(entry_count < empty_slot, "keyword table index does not fit in a slot");
+
+constexpr auto make_table() -> table
+{
+    std::uint32_t candidate = 0x9e3779b9u;
+    for (int attempt = 0; attempt < 100000; attempt++) {
+        candidate = candidate * 1664525u + 1013904223u;
+        table result;
+        result.seed = candidate | 1u;
+        for (auto& slot : result.slots) {
+            slot = empty_slot;
+        }
+
+        bool perfect = true;
+        for (std::size_t i = 0; i < entry_count && perfect; i++) {
+            auto& slot = result.slots[hash(entries[i].spelling, result.seed)];
+            perfect = slot == empty_slot;
+            slot = static_cast<std::uint8_t>(i);
+        }
+        if (perfect) {
+            return result;
+        }
+    }
+    return table{};
+}
+
+inline constexpr table lookup_table = make_table();
+static_assert(lookup_table.seed != 0, "no perfect hash found for the keyword table");
+
+// Returns the token type spelled exactly by word, if any.
+constexpr auto recognize(std::string_view word) -> std::optional<enum token::type>
+{
+    if (word.empty()) {
+        return std::nullopt;
+    }
+    std::uint8_t index = lookup_table.slots[hash(word, lookup_table.seed)];
+    if (index == empty_slot || entries[index].spelling != word) {
+        return std::nullopt;
+    }
+    return entries[index].type;
+}
+
+constexpr auto spelling(enum token::type type) -> std::string_view
+{
+    for (const entry& e : entries) {
+        if (e.type == type) {
+            return e.spelling;
+        }
+    }
+    return {};
+}
+
+static_assert(recognize("return") == token::type::key_return);
+static_assert(recognize("->") == token::type::opt_return);
+static_assert(!recognize("main").has_value());
+
+} // namespace monoa::parser::keywords
+
+#endif // MONOA_PARSER_KEYWORDS_HPP
@@ -16,9 +16,14 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <cctype>
+#include <charconv>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <utility>
+#include <parser/keywords.hpp>
 #include <parser/lexer.hpp>
+#include <parser/scanner.hpp>
 
 namespace {
 
@@ -27,9 +32,16 @@ constexpr unsigned int token_string_padding = 17;
 
 namespace monoa::parser {
 
-lexer::lexer(std::string source) : source(source)
+lexer::lexer(std::string_view source, mode mode) : source(source), streaming(mode == mode::streaming)
 {
-    this->process_source();
+    // Tokens keep 32-bit offsets.
+    if (source.size() > std::numeric_limits<std::uint32_t>::max()) {
+        this->error_string = "source larger than 4 GiB";
+        return;
+    }
+    if (mode == mode::batch) {
+        this->process_source();
+    }
 }
 
 auto lexer::error() -> std::optional<std::string>
@@ -37,18 +49,39 @@ auto lexer::error() -> std::optional<std::string>
     return this->error_string;
 }
 
-auto lexer::get_tokens() -> std::vector<token>
+auto lexer::text() -> std::string_view
+{
+    return this->source;
+}
+
+auto lexer::take_tokens() -> std::vector<token>
+{
+    return std::move(this->tokens);
+}
+
+auto lexer::symbols() -> const support::interner*
 {
-    return this->tokens;
+    return &this->names;
+}
+
+auto lexer::take_symbols() -> support::interner
+{
+    return std::move(this->names);
 }
 
 auto lexer::print_tokens() -> void
 {
-    unsigned int line = 0;
-    for (token token : this->tokens) {
-        if (token.line != line) {
-            line = token.line;
-            std::cout << token.line << std::endl;
+    // Lines are counted along the way rather than for each token.
+    unsigned int line = 1;
+    unsigned int printed = 0;
+    std::size_t counted = 0;
+    for (const token& token : this->tokens) {
+        for (; counted < token.offset; counted++) {
+            line += this->source[counted] == '\n' ? 1 : 0;
+        }
+        if (line != printed) {
+            printed = line;
+            std::cout << line << std::endl;
         }
 
         std::string message = "| " + token.type_string();
@@ -65,7 +98,7 @@ auto lexer::print_tokens() -> void
             padding += ' ';
         }
 
-        std::cout << message << padding << " : " << token.string() << std::endl;
+        std::cout << message << padding << " : " << token.string(this->source) << std::endl;
     }
 }
 
@@ -75,79 +108,58 @@ auto lexer::process_source() -> void
         if (!this->tokens.empty() && this->tokens.back().type == token::type::ctr_error) {
             break;
         }
+        this->consume_next();
+    }
+}
 
-        switch (this->peek()) {
-        case '\n':
-            this->consume_new_line();
-            break;
-        case '\t':
-        case ' ':
-            this->consume_white_space();
-            break;
-        case '+':
-            this->consume_operator(token::type::opt_plus);
-            break;
-        case '-':
-            if (this->peek_next() == '>') {
-                this->consume_operator(token::type::opt_return, 2);
-            } else {
-                this->consume_operator(token::type::opt_minus);
-            }
-            break;
-        case '*':
-            this->consume_operator(token::type::opt_star);
-            break;
-        case '/':
-            this->consume_operator(token::type::opt_slash);
-            break;
+auto lexer::next(token& next) -> bool
+{
+    if (this->has_produced && this->produced.type == token::type::ctr_error) {
+        return false;
+    }
+    this->has_produced = false;
+    while (!this->is_end() && !this->has_produced) {
+        this->consume_next();
+    }
+    if (this->has_produced) {
+        next = this->produced;
+    }
+    return this->has_produced;
+}
 
-        case '=':
-            if (this->peek_next() == '=') {
-                this->consume_operator(token::type::opt_equal_equal, 2);
-            } else {
-                this->consume_operator(token::type::opt_equal);
-            }
-            break;
-        case ':':
-            this->consume_operator(token::type::puc_colon);
-            break;
-        case ';':
-            this->consume_operator(token::type::puc_semi_colon);
-            break;
-        case '(':
-            this->consume_operator(token::type::puc_left_paren);
-            break;
-        case ')':
-            this->consume_operator(token::type::puc_right_paren);
-            break;
-        case '{':
-            this->consume_operator(token::type::puc_left_brace);
-            break;
-        case '}':
-            this->consume_operator(token::type::puc_right_brace);
-            break;
-        case 'f':
-            this->consume_keyword("fun", token::type::key_fun);
-            break;
-        case 'l':
-            this->consume_keyword("let", token::type::key_let);
-            break;
-        case 'r':
-            this->consume_keyword("return", token::type::key_return);
-            break;
-        case '"':
-            this->consume_string();
-            break;
-        default:
-            this->consume_literal();
-            break;
-        }
+auto lexer::consume_next() -> void
+{
+    switch (this->peek()) {
+    case '\n':
+        this->consume_new_line();
+        break;
+    case '\t':
+    case ' ':
+        this->consume_white_space();
+        break;
+    case '"':
+        this->consume_string();
+        break;
+    default:
+        this->consume_literal();
+        break;
     }
 }
 
-auto lexer::make_token(enum token::type type, std::string lexeme) -> void
+// The token runs from `start` to the current position.
+auto lexer::make_token(enum token::type type, unsigned int start, std::uint64_t value) -> void
 {
-    this->tokens.emplace_back(token{type, lexeme, this->line});
+    auto length = this->current - start;
+    if (length > token::max_length) {
+        this->error_string = "token longer than " + std::to_string(token::max_length) + " bytes";
+        return;
+    }
+    if (!this->streaming) {
+        this->tokens.emplace_back(type, start, length, value);
+        return;
+    }
+    this->produced = token(type, start, length, value);
+    this->has_produced = true;
 }
 
 auto lexer::is_end() -> bool
@@ -157,12 +169,7 @@ auto lexer::is_end() -> bool
 
 auto lexer::peek() -> unsigned char
 {
-    return this->source[this->current];
-}
-
-auto lexer::peek_next() -> unsigned char
-{
-    return this->is_end() ? '\0' : this->source[this->current + 1];
+    return this->current < this->source.length() ? this->source[this->current] : '\0';
 }
 
 auto lexer::consume_char(unsigned int amount) -> char
@@ -172,86 +179,101 @@ auto lexer::consume_char(unsigned int amount) -> char
     return start_char;
 }
 
-auto lexer::consume_word() -> std::string
+auto lexer::consume_word() -> std::string_view
 {
-    std::string word;
-    while (!is_end() && (std::isalnum(this->peek()) || this->peek() == '_')) {
-        word.push_back(this->consume_char());
-    }
-    return word;
+    unsigned int start = this->current;
+    this->consume_run(scanner::word_end);
+    return this->source.substr(start, this->current - start);
+}
+
+auto lexer::consume_run(const char* (*run_end)(const char*, const char*)) -> void
+{
+    const char* first = this->source.data() + this->current;
+    const char* last = this->source.data() + this->source.length();
+    this->current += run_end(first, last) - first;
 }
 
 auto lexer::consume_new_line() -> void
 {
-    this->line++;
     this->consume_char();
 }
 
 auto lexer::consume_white_space() -> void
 {
-    while (std::isblank(this->peek())) {
-        this->consume_char();
-    }
+    this->consume_run(scanner::blank_end);
 }
 
-auto lexer::consume_operator(enum token::type type, unsigned int length) -> void
+auto lexer::consume_operator() -> void
 {
-    this->consume_char(length);
-    this->make_token(type, "");
+    // Longest match first, so that "->" wins over "-".
+    for (auto length = keywords::max_operator_length; length > 0; length--) {
+        std::string_view spelling = this->source.substr(this->current, length);
+        if (auto type = keywords::recognize(spelling)) {
+            auto start = this->current;
+            this->consume_char(spelling.length());
+            this->make_token(type.value(), start);
+            return;
+        }
+    }
+    this->error_string = "invalid token in literal : " + std::to_string(this->consume_char());
 }
 
-auto lexer::consume_keyword(std::string expected, enum token::type type) -> void
+auto lexer::consume_keyword() -> void
 {
-    std::string word = this->consume_word();
-    if (!expected.empty() && word == expected) {
-        this->make_token(type, "");
-    } else if (!word.empty()) {
-        this->make_token(token::type::lit_identifier, word);
-    } else {
-        this->error_string = "empty identifier";
+    auto start = this->current;
+    std::string_view word = this->consume_word();
+    if (auto type = keywords::recognize(word)) {
+        this->make_token(type.value(), start);
+        return;
     }
+    this->make_token(token::type::lit_identifier, start, this->names.intern(word));
 }
 
 auto lexer::consume_literal() -> void
 {
-    if (std::isspace(this->peek())) {
+    if (scanner::is_class(this->peek(), scanner::cls_blank)) {
         this->consume_white_space();
-    } else if (!std::isalnum(this->peek()) && this->peek() != '_') {
-        this->error_string = "invalid token in literal : " + std::to_string(this->consume_char());
-    } else if (std::isdigit(this->peek())) {
+    } else if (scanner::is_class(this->peek(), scanner::cls_digit)) {
         this->consume_number();
+    } else if (scanner::is_class(this->peek(), scanner::cls_word)) {
+        this->consume_keyword();
     } else {
-        this->make_token(token::type::lit_identifier, this->consume_word());
+        this->consume_operator();
     }
 }
 
 auto lexer::consume_number() -> void
 {
-    std::string number;
-    enum token::type type = token::type::lit_int;
-    while (std::isdigit(this->peek())) {
-        number += this->consume_char();
-    }
+    unsigned int start = this->current;
+    this->consume_run(scanner::digit_end);
     if (this->peek() == '.') {
-        number += this->consume_char();
-        type = token::type::lit_float; // TODO: Check for trailing dot ?
-        while (std::isdigit(this->peek())) {
-            number += this->consume_char();
-        }
+        this->consume_char();
+        this->consume_run(scanner::digit_end); // TODO: Check for trailing dot ?
+        this->make_token(token::type::lit_float, start);
+        return;
+    }
+    // Decoded here so that the parser never goes back to the text, the parser
+    // reports literals that do not fit.
+    std::uint64_t value = 0;
+    const char* first = this->source.data() + start;
+    const char* last = this->source.data() + this->current;
+    auto [end, error] = std::from_chars(first, last, value);
+    if (error != std::errc() || end != last || value > std::numeric_limits<std::int64_t>::max()) {
+        value = token::out_of_range;
     }
-    this->make_token(type, number);
+    this->make_token(token::type::lit_int, start, value);
 }
 
 auto lexer::consume_string() -> void
 {
-    std::string value;
     this->consume_char();
+    unsigned int start = this->current;
     while (!is_end()) {
         if (this->peek() != '"') {
-            value += this->consume_char();
+            this->consume_char();
         } else {
+            this->make_token(token::type::lit_string, start);
             this->consume_char();
-            this->make_token(token::type::lit_string, value);
             return;
         }
     }
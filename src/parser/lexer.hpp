@@ -21,36 +21,60 @@
 
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <parser/token.hpp>
+#include <support/interner.hpp>
 
 namespace monoa::parser {
 
 class lexer
 {
 public:
-    lexer(std::string source);
-    auto get_tokens() -> std::vector<token>;
+    enum class mode
+    {
+        // Every token is lexed by the constructor.
+        batch,
+        // Tokens are lexed one at a time by next, as the parser needs them.
+        streaming,
+    };
+
+    // The lexer does not copy the source, tokens refer into it and the caller
+    // must keep the buffer alive for as long as the tokens are in use.
+    lexer(std::string_view source, mode mode = mode::batch);
+    // The source tokens refer into, for their lexemes and lines.
+    auto text() -> std::string_view;
+    auto take_tokens() -> std::vector<token>;
+    // Names of the identifiers lexed so far, by the symbol in their value.
+    auto symbols() -> const support::interner*;
+    auto take_symbols() -> support::interner;
+    // Lexes the next token, false once the source or an error ends it.
+    auto next(token& next) -> bool;
     auto print_tokens() -> void;
     auto error() -> std::optional<std::string>;
 
 private:
     unsigned int current = 0;
-    unsigned int line = 1;
     std::optional<std::string> error_string;
     std::vector<token> tokens;
-    std::string source;
+    std::string_view source;
+    support::interner names;
+    // Set by make_token when streaming, next hands it out.
+    bool streaming;
+    token produced;
+    bool has_produced = false;
     auto process_source() -> void;
-    auto make_token(enum token::type type, std::string lexeme) -> void;
+    auto consume_next() -> void;
+    auto make_token(enum token::type type, unsigned int start, std::uint64_t value = 0) -> void;
     auto is_end() -> bool;
     auto peek() -> unsigned char;
-    auto peek_next() -> unsigned char;
     auto consume_char(unsigned int amount = 1) -> char;
-    auto consume_word() -> std::string;
+    auto consume_run(const char* (*run_end)(const char*, const char*)) -> void;
+    auto consume_word() -> std::string_view;
     auto consume_new_line() -> void;
     auto consume_white_space() -> void;
-    auto consume_operator(enum token::type type, unsigned int length = 1) -> void;
-    auto consume_keyword(std::string expected, enum token::type type) -> void;
+    auto consume_operator() -> void;
+    auto consume_keyword() -> void;
     auto consume_literal() -> void;
     auto consume_number() -> void;
     auto consume_string() -> void;
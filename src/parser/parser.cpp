@@ -16,14 +16,74 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <iostream>
+#include <array>
+#include <utility>
 #include <parser/parser.hpp>
 
+namespace {
+
+using namespace monoa;
+using monoa::parser::token;
+
+// How strongly an infix operator holds its operands, zero for tokens that are
+// not one. An operator whose right power is below its left one associates
+// to the right.
+struct binding
+{
+    std::uint8_t left = 0;
+    std::uint8_t right = 0;
+    ast::operation operation = ast::operation::addition;
+};
+
+constexpr std::size_t token_type_count = static_cast<std::size_t>(token::type::ctr_error) + 1;
+
+constexpr auto make_infix_bindings() -> std::array<binding, token_type_count>
+{
+    std::array<binding, token_type_count> bindings{};
+    auto set = [&bindings](enum token::type type, std::uint8_t left, std::uint8_t right, ast::operation operation) {
+        bindings[static_cast<std::size_t>(type)] = binding{left, right, operation};
+    };
+    set(token::type::opt_equal, 2, 1, ast::operation::assignment);
+    set(token::type::opt_plus_equal, 2, 1, ast::operation::assignment_add);
+    set(token::type::opt_minus_equal, 2, 1, ast::operation::assignment_sub);
+    set(token::type::opt_equal_equal, 3, 3, ast::operation::equal);
+    set(token::type::opt_bang_equal, 3, 3, ast::operation::not_equal);
+    set(token::type::opt_greater_equal, 4, 4, ast::operation::greater_equal);
+    set(token::type::opt_lesser_equal, 4, 4, ast::operation::lesser_equal);
+    set(token::type::opt_plus, 5, 5, ast::operation::addition);
+    set(token::type::opt_minus, 5, 5, ast::operation::subtraction);
+    set(token::type::opt_star, 6, 6, ast::operation::multiplication);
+    set(token::type::opt_slash, 6, 6, ast::operation::division);
+    return bindings;
+}
+
+constexpr auto infix_bindings = make_infix_bindings();
+// Negation takes a single operand, tighter than any infix operator.
+constexpr std::uint8_t prefix_power = 7;
+
+static_assert(infix_bindings[static_cast<std::size_t>(token::type::opt_star)].left >
+                  infix_bindings[static_cast<std::size_t>(token::type::opt_plus)].left,
+              "products bind tighter than sums");
+static_assert(infix_bindings[static_cast<std::size_t>(token::type::lit_int)].left == 0,
+              "operands are not operators");
+
+} // namespace
+
 namespace monoa::parser {
 
-parser::parser(std::vector<token> tokens) : tokens(tokens)
+parser::parser(std::vector<token> tokens,
+               std::string_view source,
+               const support::interner* symbols,
+               ast::arena::policy policy)
+    : stream(std::move(tokens)), source(source), symbols(symbols)
 {
-    this->parse();
+    this->parse(policy);
+}
+
+parser::parser(lexer* source, ast::arena::policy policy)
+    : stream(source), source(source->text()), symbols(source->symbols())
+{
+    this->parse(policy);
 }
 
 auto parser::ast() -> ast::root*
@@ -38,67 +98,49 @@ auto parser::error() -> std::optional<std::string>
 
 auto parser::set_error(std::string message) -> void
 {
-    this->error_string = message + " at line : " + std::to_string(this->peek()->line);
+    this->error_string = message + " at line : " + std::to_string(this->peek()->line(this->source));
 }
 
+// The last token is never consumed, whatever follows still has a token to
+// look at.
 auto parser::is_end() -> bool
 {
-    return this->current == this->tokens.size() - 1 || this->error_string.has_value();
+    return this->stream.peek(1) == nullptr || this->error_string.has_value();
 }
 
-auto parser::peek() -> token*
+auto parser::peek() -> const token*
 {
-    return &this->tokens[this->current];
+    static const token none;
+    const auto* current = this->stream.peek();
+    return current != nullptr ? current : &none;
 }
 
-auto parser::advance() -> token*
+auto parser::advance() -> const token*
 {
+    const auto* current = this->peek();
     if (!this->is_end()) {
-        return &this->tokens[this->current++];
-    } else {
-        return &this->tokens[this->current];
+        this->stream.advance();
     }
+    return current;
 }
 
-auto parser::parse() -> void
+auto parser::parse(ast::arena::policy policy) -> void
 {
-    this->syntax_tree = std::make_unique<ast::root>();
+    this->syntax_tree = std::make_unique<ast::root>(policy);
+    this->syntax_tree->symbols = this->symbols;
     this->syntax_tree->statement_list = this->make_compound_statement();
 }
 
-auto parser::token_to_operation(token* token) -> ast::operation
+auto parser::skip_semi_colon() -> void
 {
-    switch (token->type) {
-    case token::type::opt_plus:
-        return ast::operation::addition;
-    case token::type::opt_minus:
-        return ast::operation::subtraction;
-    case token::type::opt_star:
-        return ast::operation::multiplication;
-    case token::type::opt_slash:
-        return ast::operation::division;
-    default:
-        this->set_error("invalid token" + token->string());
-        return ast::operation::addition;
-    }
-}
-
-auto parser::match(std::vector<enum token::type> types) -> bool
-{
-    for (enum token::type type : types) {
-        if (type == this->peek()->type) {
-            return true;
-        } else if (this->peek()->type == token::type::puc_semi_colon) {
-            this->advance();
-            return false;
-        }
+    if (this->peek()->type == token::type::puc_semi_colon) {
+        this->advance();
     }
-    return false;
 }
 
-auto parser::make_compound_statement() -> std::unique_ptr<ast::compound_statement>
+auto parser::make_compound_statement() -> ast::compound_statement*
 {
-    auto comp_stmt = std::make_unique<ast::compound_statement>();
+    auto comp_stmt = this->make<ast::compound_statement>(&this->syntax_tree->memory);
 
     std::optional<enum token::type> end_token;
     if (this->peek()->type == token::type::puc_left_brace) {
@@ -118,7 +160,7 @@ auto parser::make_compound_statement() -> std::unique_ptr<ast::compound_statemen
             comp_stmt->statements.emplace_back(this->make_return());
             break;
         default:
-            this->set_error("unexpected '" + this->peek()->string() + "'");
+            this->set_error("unexpected '" + this->peek()->string(this->source) + "'");
         }
     }
 
@@ -129,58 +171,81 @@ auto parser::make_compound_statement() -> std::unique_ptr<ast::compound_statemen
     return comp_stmt;
 }
 
-auto parser::make_expression() -> std::unique_ptr<ast::expression>
+// Parses operators binding tighter than `power`, climbing through the table
+// instead of one function per precedence level.
+auto parser::make_expression(std::uint8_t power) -> ast::expression*
 {
-    auto expr = this->make_addition();
-    return expr;
-}
-
-auto parser::make_addition() -> std::unique_ptr<ast::expression>
-{
-    auto expr = this->make_multiplication();
-    while (this->match({token::type::opt_plus, token::type::opt_minus})) {
-        auto op = this->token_to_operation(this->advance());
-        expr = std::make_unique<ast::binary_operation>(std::move(expr), op, this->make_multiplication());
+    auto expr = this->make_prefix();
+    while (!this->error_string.has_value()) {
+        const auto& infix = infix_bindings[static_cast<std::size_t>(this->peek()->type)];
+        if (infix.left <= power) {
+            break;
+        }
+        this->advance();
+        expr = this->make<ast::binary_operation>(expr, infix.operation, this->make_expression(infix.right));
     }
     return expr;
 }
 
-auto parser::make_multiplication() -> std::unique_ptr<ast::expression>
+auto parser::make_prefix() -> ast::expression*
 {
-    auto expr = this->make_literal();
-    while (this->match({token::type::opt_star, token::type::opt_slash})) {
-        auto op = this->token_to_operation(this->advance());
-        expr = std::make_unique<ast::binary_operation>(std::move(expr), op, this->make_literal());
+    switch (this->peek()->type) {
+    case token::type::lit_int: {
+        auto c = this->make<ast::literal>();
+        const auto* literal = this->advance();
+        if (literal->value == token::out_of_range) {
+            this->set_error("integer literal '" + literal->string(this->source) + "' out of range");
+        }
+        c->value = static_cast<std::int64_t>(literal->value == token::out_of_range ? 0 : literal->value);
+        c->type = ast::scalar_type(ast::basic_type::i64);
+        return c;
+    }
+    case token::type::lit_identifier: {
+        auto ref = this->make<ast::variable_reference>();
+        ref->name = static_cast<support::symbol>(this->advance()->value);
+        return ref;
+    }
+    case token::type::opt_minus: {
+        this->advance();
+        auto un_op = this->make<ast::unary_operation>();
+        un_op->op = ast::operation::negation;
+        un_op->right = this->make_expression(prefix_power);
+        return un_op;
+    }
+    case token::type::puc_left_paren: {
+        this->advance();
+        auto expr = this->make_expression();
+        if (this->peek()->type != token::type::puc_right_paren) {
+            this->set_error("expecting ')'");
+        } else {
+            this->advance();
+        }
+        return expr;
+    }
+    default:
+        this->set_error("expecting expression, got '" + this->peek()->string(this->source) + "'");
+        return this->make<ast::literal>();
     }
-    return expr;
-}
-
-auto parser::make_literal() -> std::unique_ptr<ast::expression>
-{
-    auto c = std::make_unique<ast::literal>();
-    auto value = this->advance()->lexeme;
-    c->value = std::stol(value);
-    c->type = std::make_unique<ast::scalar_type>(ast::basic_type::i64);
-    return c;
 }
 
-auto parser::make_decl_var() -> std::unique_ptr<ast::variable_declaration>
+auto parser::make_decl_var() -> ast::variable_declaration*
 {
-    auto var_decl = std::make_unique<ast::variable_declaration>();
+    auto var_decl = this->make<ast::variable_declaration>();
     this->advance();
     if (this->peek()->type != token::type::lit_identifier) {
         this->set_error("expecting variable name");
         return var_decl;
     }
-    var_decl->name = this->advance()->lexeme;
+    var_decl->name = static_cast<support::symbol>(this->advance()->value);
     this->advance(); // assignment
     var_decl->expr = make_expression();
+    this->skip_semi_colon();
     return var_decl;
 }
 
-auto parser::make_decl_fun() -> std::unique_ptr<ast::function_declaration>
+auto parser::make_decl_fun() -> ast::function_declaration*
 {
-    auto fun_decl = std::make_unique<ast::function_declaration>();
+    auto fun_decl = this->make<ast::function_declaration>(&this->syntax_tree->memory);
     this->advance();
 
     if (this->peek()->type != token::type::lit_identifier) {
@@ -188,30 +253,30 @@ auto parser::make_decl_fun() -> std::unique_ptr<ast::function_declaration>
         return fun_decl;
     }
 
-    fun_decl->name = this->advance()->lexeme;
-    fun_decl->parameters = this->make_fun_parameters();
+    fun_decl->name = static_cast<support::symbol>(this->advance()->value);
+    this->make_fun_parameters();
     if (this->peek()->type == token::type::opt_return) {
         advance(); // return opt
-        fun_decl->return_type = std::make_unique<ast::scalar_type>(ast::basic_type::i32);
+        fun_decl->return_type = this->make<ast::scalar_type>(ast::basic_type::i32);
         advance();
     }
     fun_decl->statement_list = this->make_compound_statement();
     return fun_decl;
 }
 
-auto parser::make_fun_parameters() -> std::vector<std::unique_ptr<ast::function_parameter>>
+// Functions take no parameters yet, the empty list is skipped.
+auto parser::make_fun_parameters() -> void
 {
     this->advance();
     this->advance();
-    auto fun_parameters = std::vector<std::unique_ptr<ast::function_parameter>>();
-    return fun_parameters;
 }
 
-auto parser::make_return() -> std::unique_ptr<ast::return_statement>
+auto parser::make_return() -> ast::return_statement*
 {
-    auto ret_stmt = std::make_unique<ast::return_statement>();
+    auto ret_stmt = this->make<ast::return_statement>();
     this->advance();
     ret_stmt->return_value = this->make_expression();
+    this->skip_semi_colon();
     return ret_stmt;
 }
 
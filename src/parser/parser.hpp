@@ -19,43 +19,60 @@
 #ifndef MONOA_PARSER_PARSER_HPP
 #define MONOA_PARSER_PARSER_HPP
 
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <ast/ast.hpp>
+#include <parser/lexer.hpp>
 #include <parser/token.hpp>
+#include <parser/token_stream.hpp>
 
 namespace monoa::parser {
 
 class parser
 {
 public:
-    parser(std::vector<token> tokens);
+    // Tokens refer into `source`, which must outlive the parse, and name
+    // their identifiers by symbols of `symbols`, which must outlive the tree.
+    parser(std::vector<token> tokens,
+           std::string_view source,
+           const support::interner* symbols,
+           ast::arena::policy policy = ast::arena::policy::block);
+    // Pulls tokens from a streaming lexer while parsing, the caller checks
+    // the lexer for errors once done.
+    parser(lexer* source, ast::arena::policy policy = ast::arena::policy::block);
     auto ast() -> ast::root*;
     auto error() -> std::optional<std::string>;
 
 private:
-    unsigned int current = 0;
-    std::vector<token> tokens;
+    token_stream stream;
+    std::string_view source;
+    const support::interner* symbols;
     std::optional<std::string> error_string;
     std::unique_ptr<ast::root> syntax_tree;
 
+    template <typename T, typename... Args>
+    auto make(Args&&... args) -> T*
+    {
+        return this->syntax_tree->memory.make<T>(std::forward<Args>(args)...);
+    }
+
     auto set_error(std::string message) -> void;
     auto is_end() -> bool;
-    auto peek() -> token*;
-    auto advance() -> token*;
-    auto parse() -> void;
-    auto token_to_operation(token* type) -> ast::operation;
-    auto match(std::vector<enum token::type> types) -> bool;
-    auto make_compound_statement() -> std::unique_ptr<ast::compound_statement>;
-    auto make_expression() -> std::unique_ptr<ast::expression>;
-    auto make_addition() -> std::unique_ptr<ast::expression>;
-    auto make_multiplication() -> std::unique_ptr<ast::expression>;
-    auto make_literal() -> std::unique_ptr<ast::expression>;
-    auto make_decl_var() -> std::unique_ptr<ast::variable_declaration>;
-    auto make_decl_fun() -> std::unique_ptr<ast::function_declaration>;
-    auto make_fun_parameters() -> std::vector<std::unique_ptr<ast::function_parameter>>;
-    auto make_return() -> std::unique_ptr<ast::return_statement>;
+    auto peek() -> const token*;
+    auto advance() -> const token*;
+    auto parse(ast::arena::policy policy) -> void;
+    auto skip_semi_colon() -> void;
+    auto make_compound_statement() -> ast::compound_statement*;
+    auto make_expression(std::uint8_t power = 0) -> ast::expression*;
+    auto make_prefix() -> ast::expression*;
+    auto make_decl_var() -> ast::variable_declaration*;
+    auto make_decl_fun() -> ast::function_declaration*;
+    auto make_fun_parameters() -> void;
+    auto make_return() -> ast::return_statement*;
 };
 
 } // namespace monoa::parser
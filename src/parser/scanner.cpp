@@ -0,0 +1,238 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <parser/scanner.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MONOA_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using namespace monoa::parser::scanner;
+
+using scan_function = auto (*)(const char*, const char*) -> const char*;
+
+struct implementation
+{
+    isa set;
+    scan_function word_end;
+    scan_function digit_end;
+    scan_function blank_end;
+};
+
+template <std::uint8_t cls>
+auto scalar_end(const char* first, const char* last) -> const char*
+{
+    while (first != last && is_class(*first, cls)) {
+        first++;
+    }
+    return first;
+}
+
+#ifdef MONOA_SCANNER_X86
+
+// Byte ranges are tested with the unsigned min trick,
+// (c - lo) <= (hi - lo) <=> min(c - lo, hi - lo) == c - lo.
+// The AVX2 kernels mirror the SSE2 ones, they are kept separate so that no
+// AVX instruction can leak into the code run on cpus without it.
+
+template <char lo, char hi>
+inline auto sse2_in_range(__m128i v) -> __m128i
+{
+    __m128i t = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(static_cast<char>(hi - lo))), t);
+}
+
+inline auto sse2_digit(__m128i v) -> __m128i
+{
+    return sse2_in_range<'0', '9'>(v);
+}
+
+inline auto sse2_word(__m128i v) -> __m128i
+{
+    __m128i alpha = sse2_in_range<'a', 'z'>(_mm_or_si128(v, _mm_set1_epi8(0x20)));
+    __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(sse2_digit(v), alpha), underscore);
+}
+
+inline auto sse2_blank(__m128i v) -> __m128i
+{
+    // '\n' sits between '\t' and '\v' and is left to the lexer to count lines.
+    __m128i control = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), sse2_in_range<'\v', '\r'>(v));
+    return _mm_or_si128(control, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+}
+
+template <__m128i (*match)(__m128i), std::uint8_t cls>
+auto sse2_end(const char* first, const char* last) -> const char*
+{
+    while (last - first >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        auto stop = static_cast<std::uint32_t>(_mm_movemask_epi8(match(v))) ^ 0xffffu;
+        if (stop != 0) {
+            return first + __builtin_ctz(stop);
+        }
+        first += 16;
+    }
+    return scalar_end<cls>(first, last);
+}
+
+template <char lo, char hi>
+__attribute__((target("avx2"))) inline auto avx2_in_range(__m256i v) -> __m256i
+{
+    __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(static_cast<char>(hi - lo))), t);
+}
+
+__attribute__((target("avx2"))) inline auto avx2_digit(__m256i v) -> __m256i
+{
+    return avx2_in_range<'0', '9'>(v);
+}
+
+__attribute__((target("avx2"))) inline auto avx2_word(__m256i v) -> __m256i
+{
+    __m256i alpha = avx2_in_range<'a', 'z'>(_mm256_or_si256(v, _mm256_set1_epi8(0x20)));
+    __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return _mm256_or_si256(_mm256_or_si256(avx2_digit(v), alpha), underscore);
+}
+
+__attribute__((target("avx2"))) inline auto avx2_blank(__m256i v) -> __m256i
+{
+    __m256i control =
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')), avx2_in_range<'\v', '\r'>(v));
+    return _mm256_or_si256(control, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+}
+
+template <__m256i (*match)(__m256i), std::uint8_t cls>
+__attribute__((target("avx2"))) auto avx2_end(const char* first, const char* last) -> const char*
+{
+    while (last - first >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        auto stop = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(match(v)));
+        if (stop != 0) {
+            return first + __builtin_ctz(stop);
+        }
+        first += 32;
+    }
+    return scalar_end<cls>(first, last);
+}
+
+#endif // MONOA_SCANNER_X86
+
+constexpr implementation scalar_implementation = {
+    isa::scalar,
+    scalar_end<cls_word>,
+    scalar_end<cls_digit>,
+    scalar_end<cls_blank>,
+};
+
+#ifdef MONOA_SCANNER_X86
+constexpr implementation sse2_implementation = {
+    isa::sse2,
+    sse2_end<sse2_word, cls_word>,
+    sse2_end<sse2_digit, cls_digit>,
+    sse2_end<sse2_blank, cls_blank>,
+};
+
+constexpr implementation avx2_implementation = {
+    isa::avx2,
+    avx2_end<avx2_word, cls_word>,
+    avx2_end<avx2_digit, cls_digit>,
+    avx2_end<avx2_blank, cls_blank>,
+};
+#endif
+
+auto implementation_for(isa set) -> const implementation*
+{
+    switch (set) {
+#ifdef MONOA_SCANNER_X86
+    case isa::avx2:
+        return &avx2_implementation;
+    case isa::sse2:
+        return &sse2_implementation;
+#endif
+    default:
+        return &scalar_implementation;
+    }
+}
+
+const implementation* current = implementation_for(detect());
+
+} // namespace
+
+namespace monoa::parser::scanner {
+
+auto detect() -> isa
+{
+#ifdef MONOA_SCANNER_X86
+    // May run from a static initializer, before the cpu model is set up.
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return isa::avx2;
+    }
+    return isa::sse2;
+#else
+    return isa::scalar;
+#endif
+}
+
+auto select(isa set) -> isa
+{
+    if (set > detect()) {
+        set = detect();
+    }
+    current = implementation_for(set);
+    return current->set;
+}
+
+auto selected() -> isa
+{
+    return current->set;
+}
+
+auto isa_name(isa set) -> const char*
+{
+    switch (set) {
+    case isa::scalar:
+        return "scalar";
+    case isa::sse2:
+        return "sse2";
+    case isa::avx2:
+        return "avx2";
+    default:
+        return "unknow";
+    }
+}
+
+auto word_end(const char* first, const char* last) -> const char*
+{
+    return current->word_end(first, last);
+}
+
+auto digit_end(const char* first, const char* last) -> const char*
+{
+    return current->digit_end(first, last);
+}
+
+auto blank_end(const char* first, const char* last) -> const char*
+{
+    return current->blank_end(first, last);
+}
+
+} // namespace monoa::parser::scanner
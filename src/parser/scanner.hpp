@@ -0,0 +1,87 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_PARSER_SCANNER_HPP
+#define MONOA_PARSER_SCANNER_HPP
+
+#include <array>
+#include <cstdint>
+
+namespace monoa::parser::scanner {
+
+enum char_class : std::uint8_t
+{
+    cls_none = 0,
+    cls_digit = 1 << 0,
+    cls_alpha = 1 << 1,
+    cls_underscore = 1 << 2,
+    cls_blank = 1 << 3,
+
+    cls_word = cls_digit | cls_alpha | cls_underscore,
+};
+
+constexpr auto make_class_table() -> std::array<std::uint8_t, 256>
+{
+    std::array<std::uint8_t, 256> table = {};
+    for (int c = '0'; c <= '9'; c++) {
+        table[c] = cls_digit;
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+        table[c] = cls_alpha;
+        table[c - 'a' + 'A'] = cls_alpha;
+    }
+    table['_'] = cls_underscore;
+    table[' '] = cls_blank;
+    table['\t'] = cls_blank;
+    table['\r'] = cls_blank;
+    table['\v'] = cls_blank;
+    table['\f'] = cls_blank;
+    return table;
+}
+
+inline constexpr std::array<std::uint8_t, 256> class_table = make_class_table();
+
+inline auto is_class(char c, std::uint8_t cls) -> bool
+{
+    return (class_table[static_cast<unsigned char>(c)] & cls) != 0;
+}
+
+enum class isa
+{
+    scalar,
+    sse2,
+    avx2,
+};
+
+// Returns the best instruction set supported by the running cpu.
+auto detect() -> isa;
+// Selects the implementation used by the *_end functions, defaults to detect().
+// Requesting an isa the cpu cannot run falls back to the best supported one.
+auto select(isa set) -> isa;
+auto selected() -> isa;
+auto isa_name(isa set) -> const char*;
+
+// Each function returns a pointer to the first character in [first, last)
+// that is not part of the run, or last if the whole range matches.
+auto word_end(const char* first, const char* last) -> const char*;
+auto digit_end(const char* first, const char* last) -> const char*;
+auto blank_end(const char* first, const char* last) -> const char*;
+
+} // namespace monoa::parser::scanner
+
+#endif // MONOA_PARSER_SCANNER_HPP
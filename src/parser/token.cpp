@@ -16,56 +16,36 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <parser/keywords.hpp>
 #include <parser/token.hpp>
 
 namespace monoa::parser {
 
-auto token::string() -> std::string
+// Lines are only needed for messages, they are counted when asked for.
+auto token::line(std::string_view source) const -> unsigned int
+{
+    auto end = source.begin() + std::min<std::size_t>(this->offset, source.size());
+    return 1 + static_cast<unsigned int>(std::count(source.begin(), end, '\n'));
+}
+
+auto token::string(std::string_view source) const -> std::string
 {
     switch (this->type) {
-    case token::type::puc_left_paren:
-        return "(";
-    case token::type::puc_right_paren:
-        return ")";
-    case token::type::puc_left_brace:
-        return "{";
-    case token::type::puc_right_brace:
-        return "}";
-    case token::type::puc_colon:
-        return ":";
-    case token::type::puc_semi_colon:
-        return ";";
-    case token::type::opt_plus:
-        return "+";
-    case token::type::opt_minus:
-        return "-";
-    case token::type::opt_star:
-        return "*";
-    case token::type::opt_slash:
-        return "/";
-    case token::type::opt_equal:
-        return "=";
-    case token::type::opt_return:
-        return "->";
-    case token::type::key_let:
-        return "let";
-    case token::type::key_fun:
-        return "fun";
-    case token::type::key_return:
-        return "return";
     case token::type::lit_identifier:
     case token::type::lit_int:
     case token::type::lit_float:
     case token::type::lit_string:
-        return this->lexeme;
+        return std::string(this->lexeme(source));
     case token::type::ctr_error:
         return "error";
     default:
-        return "ctr_unknow";
+        std::string_view spelling = keywords::spelling(this->type);
+        return spelling.empty() ? "ctr_unknow" : std::string(spelling);
     }
 }
 
-auto token::type_string() -> std::string
+auto token::type_string() const -> std::string
 {
     switch (this->type) {
     case token::type::puc_left_paren:
@@ -76,6 +56,10 @@ auto token::type_string() -> std::string
         return "puc_left_brace";
     case token::type::puc_right_brace:
         return "puc_right_brace";
+    case token::type::puc_dot:
+        return "puc_dot";
+    case token::type::puc_comma:
+        return "puc_comma";
     case token::type::puc_colon:
         return "puc_colon";
     case token::type::puc_semi_colon:
@@ -88,8 +72,26 @@ auto token::type_string() -> std::string
         return "opt_star";
     case token::type::opt_slash:
         return "opt_slash";
+    case token::type::opt_plus_equal:
+        return "opt_plus_equal";
+    case token::type::opt_minus_equal:
+        return "opt_minus_equal";
     case token::type::opt_equal:
         return "opt_equal";
+    case token::type::opt_equal_equal:
+        return "opt_equal_equal";
+    case token::type::opt_bang:
+        return "opt_bang";
+    case token::type::opt_bang_equal:
+        return "opt_bang_equal";
+    case token::type::opt_greater:
+        return "opt_greater";
+    case token::type::opt_greater_equal:
+        return "opt_greater_equal";
+    case token::type::opt_lesser:
+        return "opt_lesser";
+    case token::type::opt_lesser_equal:
+        return "opt_lesser_equal";
     case token::type::opt_return:
         return "opt_return";
     case token::type::lit_identifier:
@@ -100,6 +102,18 @@ auto token::type_string() -> std::string
         return "lit_float";
     case token::type::lit_string:
         return "lit_string";
+    case token::type::typ_int:
+        return "typ_int";
+    case token::type::typ_dec:
+        return "typ_dec";
+    case token::type::typ_string:
+        return "typ_string";
+    case token::type::key_if:
+        return "key_if";
+    case token::type::key_else:
+        return "key_else";
+    case token::type::key_for:
+        return "key_for";
     case token::type::key_let:
         return "key_let";
     case token::type::key_fun:
@@ -19,14 +19,21 @@
 #ifndef MONOA_PARSER_TOKEN_HPP
 #define MONOA_PARSER_TOKEN_HPP
 
+#include <cstdint>
+#include <limits>
 #include <string>
+#include <string_view>
 
 namespace monoa::parser {
 
+// A token is 16 bytes and keeps no text of its own: it refers to its lexeme
+// by offset into the source, which also gives its line. Integer literals come
+// decoded by the lexer, and identifiers as the symbol their name was interned
+// to.
 class token
 {
 public:
-    enum class type
+    enum class type : std::uint8_t
     {
         puc_left_paren,
         puc_right_paren,
@@ -41,6 +48,8 @@ public:
         opt_minus,
         opt_star,
         opt_slash,
+        opt_plus_equal,
+        opt_minus_equal,
 
         opt_equal,
         opt_equal_equal,
@@ -72,13 +81,37 @@ public:
         ctr_error
     };
 
-    type type = type::ctr_error;
-    std::string lexeme = "";
-    unsigned int line = 0;
-    auto string() -> std::string;
-    auto type_string() -> std::string;
+    // Longest lexeme a token can refer to.
+    static constexpr std::uint32_t max_length = (1u << 24) - 1;
+    // Value of an integer literal too large for an i64.
+    static constexpr std::uint64_t out_of_range = std::numeric_limits<std::uint64_t>::max();
+
+    std::uint64_t value;
+    std::uint32_t offset;
+    std::uint32_t length : 24;
+    enum type type : 8;
+
+    token() : value(0), offset(0), length(0), type(type::ctr_error)
+    {
+    }
+
+    token(enum type type, std::uint32_t offset, std::uint32_t length, std::uint64_t value = 0)
+        : value(value), offset(offset), length(length), type(type)
+    {
+    }
+
+    auto lexeme(std::string_view source) const -> std::string_view
+    {
+        return source.substr(this->offset, this->length);
+    }
+
+    auto line(std::string_view source) const -> unsigned int;
+    auto string(std::string_view source) const -> std::string;
+    auto type_string() const -> std::string;
 };
 
+static_assert(sizeof(token) == 16, "tokens stay packed");
+
 } // namespace monoa::parser
 
 #endif // MONOA_PARSER_TOKEN_HPP
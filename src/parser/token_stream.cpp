@@ -0,0 +1,46 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <utility>
+#include <parser/token_stream.hpp>
+
+namespace monoa::parser {
+
+token_stream::token_stream(std::vector<token> tokens) : tokens(std::move(tokens))
+{
+}
+
+token_stream::token_stream(lexer* source) : source(source)
+{
+}
+
+// `position` counts tokens advanced past, the slots after it hold tokens
+// lexed but not consumed yet.
+auto token_stream::fill(std::size_t ahead) -> void
+{
+    while (this->buffered <= ahead && !this->exhausted) {
+        auto& slot = this->ring[(this->position + this->buffered) % ring_size];
+        if (this->source->next(slot)) {
+            this->buffered++;
+        } else {
+            this->exhausted = true;
+        }
+    }
+}
+
+} // namespace monoa::parser
@@ -0,0 +1,86 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_PARSER_TOKEN_STREAM_HPP
+#define MONOA_PARSER_TOKEN_STREAM_HPP
+
+#include <array>
+#include <cstddef>
+#include <vector>
+#include <parser/lexer.hpp>
+#include <parser/token.hpp>
+
+namespace monoa::parser {
+
+// Tokens for the parser, either from a vector lexed beforehand or pulled from
+// a streaming lexer as the parser gets to them. Streamed tokens go through a
+// ring of a few slots, so memory stays the same whatever the size of the
+// source.
+class token_stream
+{
+public:
+    // How far past the current token peek can look.
+    static constexpr std::size_t lookahead = 1;
+
+    token_stream(std::vector<token> tokens);
+    token_stream(lexer* source);
+    // Token `ahead` places after the current one, nothing past the end. The
+    // parser calls these for every token, they stay in the header to be
+    // inlined.
+    auto peek(std::size_t ahead = 0) -> token*
+    {
+        if (this->source == nullptr) {
+            return this->position + ahead < this->tokens.size() ? &this->tokens[this->position + ahead] : nullptr;
+        }
+        if (ahead >= this->buffered) {
+            this->fill(ahead);
+        }
+        return ahead < this->buffered ? &this->ring[(this->position + ahead) % ring_size] : nullptr;
+    }
+
+    // Moves past the current token, which stays valid until the next advance.
+    auto advance() -> void
+    {
+        if (this->source != nullptr) {
+            if (this->buffered == 0) {
+                return;
+            }
+            this->buffered--;
+        }
+        this->position++;
+    }
+
+private:
+    // The current token, its lookahead and the token just advanced past.
+    static constexpr std::size_t ring_size = 4;
+    static_assert(lookahead + 2 <= ring_size, "the ring holds every token in use");
+
+    lexer* source = nullptr;
+    std::vector<token> tokens;
+    std::size_t position = 0;
+
+    std::array<token, ring_size> ring;
+    std::size_t buffered = 0;
+    bool exhausted = false;
+
+    auto fill(std::size_t ahead) -> void;
+};
+
+} // namespace monoa::parser
+
+#endif // MONOA_PARSER_TOKEN_STREAM_HPP
@@ -0,0 +1,127 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <support/interner.hpp>
+
+namespace {
+
+constexpr std::size_t block_size = 64 * 1024;
+constexpr std::size_t initial_slots = 1024;
+
+// Eight bytes at a time, names are mostly short.
+auto hash(std::string_view name) -> std::uint32_t
+{
+    std::uint64_t h = 0x9e3779b97f4a7c15 ^ name.size();
+    const char* data = name.data();
+    auto size = name.size();
+    for (; size >= 8; data += 8, size -= 8) {
+        std::uint64_t chunk;
+        std::memcpy(&chunk, data, 8);
+        h = (h ^ chunk) * 0xbf58476d1ce4e5b9;
+        h ^= h >> 31;
+    }
+    if (size > 0) {
+        std::uint64_t chunk = 0;
+        std::memcpy(&chunk, data, size);
+        h = (h ^ chunk) * 0xbf58476d1ce4e5b9;
+        h ^= h >> 31;
+    }
+    h *= 0x94d049bb133111eb;
+    return static_cast<std::uint32_t>(h >> 32);
+}
+
+} // namespace
+
+namespace monoa::support {
+
+interner::interner() : slots(initial_slots, empty_slot)
+{
+}
+
+auto interner::intern(std::string_view name) -> symbol
+{
+    auto h = hash(name);
+    auto mask = this->slots.size() - 1;
+    for (auto i = h & mask;; i = (i + 1) & mask) {
+        auto slot = this->slots[i];
+        if (slot == empty_slot) {
+            auto result = static_cast<symbol>(this->names.size());
+            this->names.push_back(this->store(name));
+            this->hashes.push_back(h);
+            this->slots[i] = result;
+            if (this->names.size() * 2 > this->slots.size()) {
+                this->grow();
+            }
+            return result;
+        }
+        if (this->hashes[slot] == h && this->names[slot] == name) {
+            return slot;
+        }
+    }
+}
+
+auto interner::size() const -> std::size_t
+{
+    return this->names.size();
+}
+
+// Text of the names, and what finding them takes.
+auto interner::bytes_used() const -> std::size_t
+{
+    return this->used + this->names.size() * (sizeof(std::string_view) + sizeof(std::uint32_t)) +
+           this->slots.size() * sizeof(symbol);
+}
+
+auto interner::store(std::string_view name) -> std::string_view
+{
+    if (name.size() > this->left) {
+        auto size = name.size() > block_size / 4 ? name.size() : block_size;
+        auto& block = this->blocks.emplace_back(new char[size]);
+        // A name too long to share a block leaves the current one in use.
+        if (size != block_size) {
+            std::memcpy(block.get(), name.data(), name.size());
+            this->used += name.size();
+            return std::string_view(block.get(), name.size());
+        }
+        this->cursor = block.get();
+        this->left = size;
+    }
+    std::memcpy(this->cursor, name.data(), name.size());
+    std::string_view result(this->cursor, name.size());
+    this->cursor += name.size();
+    this->left -= name.size();
+    this->used += name.size();
+    return result;
+}
+
+auto interner::grow() -> void
+{
+    std::vector<symbol> grown(this->slots.size() * 2, empty_slot);
+    auto mask = grown.size() - 1;
+    for (symbol s = 0; s < this->names.size(); s++) {
+        auto i = this->hashes[s] & mask;
+        while (grown[i] != empty_slot) {
+            i = (i + 1) & mask;
+        }
+        grown[i] = s;
+    }
+    this->slots = std::move(grown);
+}
+
+} // namespace monoa::support
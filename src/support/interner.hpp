@@ -0,0 +1,74 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_SUPPORT_INTERNER_HPP
+#define MONOA_SUPPORT_INTERNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace monoa::support {
+
+// Identifies an interned name, dense from zero in the order names were first
+// seen. Two names are the same when their symbols are.
+using symbol = std::uint32_t;
+
+// Gives every distinct name of a compilation a symbol. The text of each name
+// is kept once, in blocks owned by the interner, so a name looked up many
+// times costs its text once and a symbol per use.
+class interner
+{
+public:
+    interner();
+    interner(const interner&) = delete;
+    auto operator=(const interner&) -> interner& = delete;
+    interner(interner&&) = default;
+    auto operator=(interner&&) -> interner& = default;
+    auto intern(std::string_view name) -> symbol;
+    // Text of a symbol, valid for as long as the interner.
+    auto name(symbol symbol) const -> std::string_view
+    {
+        return this->names[symbol];
+    }
+    auto size() const -> std::size_t;
+    auto bytes_used() const -> std::size_t;
+
+private:
+    static constexpr symbol empty_slot = ~symbol(0);
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    std::size_t left = 0;
+    std::size_t used = 0;
+
+    std::vector<std::string_view> names;
+    std::vector<std::uint32_t> hashes;
+    // Open addressing over symbols, a power of two in size and at most half
+    // full.
+    std::vector<symbol> slots;
+
+    auto store(std::string_view name) -> std::string_view;
+    auto grow() -> void;
+};
+
+} // namespace monoa::support
+
+#endif // MONOA_SUPPORT_INTERNER_HPP
@@ -0,0 +1,155 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <support/scheduler.hpp>
+#include <support/thread_pool.hpp>
+
+namespace {
+
+// Worker number of the current thread within the scheduler it works for.
+thread_local const monoa::support::scheduler* current_scheduler = nullptr;
+thread_local unsigned int current_worker = 0;
+
+} // namespace
+
+namespace monoa::support {
+
+scheduler::scheduler(unsigned int threads)
+{
+    if (threads == 0) {
+        threads = hardware_threads();
+    }
+    for (unsigned int worker = 0; worker < threads; worker++) {
+        this->queues.push_back(std::make_unique<queue>());
+    }
+    for (unsigned int worker = 0; worker + 1 < threads; worker++) {
+        this->threads.emplace_back([this, worker]() { this->work(worker); });
+    }
+}
+
+scheduler::~scheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto& thread : this->threads) {
+        thread.join();
+    }
+}
+
+auto scheduler::size() const -> unsigned int
+{
+    return static_cast<unsigned int>(this->queues.size());
+}
+
+auto scheduler::submit(std::function<void()> task) -> void
+{
+    auto worker = current_scheduler == this ? current_worker : this->next_queue++ % this->size();
+    this->pending++;
+    {
+        // Counted before it is queued, so that taking it never goes below zero.
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->queued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->queues[worker]->mutex);
+        this->queues[worker]->tasks.push_back(std::move(task));
+    }
+    this->wake.notify_all();
+}
+
+auto scheduler::wait() -> void
+{
+    auto* previous_scheduler = current_scheduler;
+    auto previous_worker = current_worker;
+    current_scheduler = this;
+    current_worker = this->size() - 1;
+
+    std::function<void()> task;
+    while (true) {
+        if (this->take(current_worker, task)) {
+            this->run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->wake.wait(lock, [this]() { return this->pending == 0 || this->queued > 0; });
+        if (this->pending == 0) {
+            break;
+        }
+    }
+
+    current_scheduler = previous_scheduler;
+    current_worker = previous_worker;
+}
+
+auto scheduler::work(unsigned int worker) -> void
+{
+    current_scheduler = this;
+    current_worker = worker;
+
+    std::function<void()> task;
+    while (true) {
+        if (this->take(worker, task)) {
+            this->run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->wake.wait(lock, [this]() { return this->stopping || this->queued > 0; });
+        if (this->stopping && this->queued == 0) {
+            return;
+        }
+    }
+}
+
+// Newest task of the worker's own queue first, it is the most likely to
+// still be in cache, then the oldest task of any other queue.
+auto scheduler::take(unsigned int worker, std::function<void()>& task) -> bool
+{
+    auto count = this->size();
+    for (unsigned int i = 0; i < count; i++) {
+        auto& victim = *this->queues[(worker + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+        } else {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+        this->queued--;
+        return true;
+    }
+    return false;
+}
+
+auto scheduler::run(std::function<void()>& task) -> void
+{
+    task();
+    task = nullptr;
+    if (--this->pending == 0) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->wake.notify_all();
+    }
+}
+
+} // namespace monoa::support
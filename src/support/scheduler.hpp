@@ -0,0 +1,78 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_SUPPORT_SCHEDULER_HPP
+#define MONOA_SUPPORT_SCHEDULER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace monoa::support {
+
+// Runs independent tasks of uneven size. Every worker has a queue of its own
+// that it takes tasks from the back of, and steals from the front of the
+// others when it runs dry, so one long task never holds up the rest. The
+// thread calling wait() takes part as the last worker.
+class scheduler
+{
+public:
+    // Zero threads means one per hardware thread.
+    scheduler(unsigned int threads = 0);
+    scheduler(const scheduler&) = delete;
+    auto operator=(const scheduler&) -> scheduler& = delete;
+    ~scheduler();
+    // Number of workers, the waiting thread included.
+    auto size() const -> unsigned int;
+    // Queues a task, on the queue of the calling worker when a task submits
+    // it and spread over the queues otherwise.
+    auto submit(std::function<void()> task) -> void;
+    // Runs tasks until every submitted task has finished.
+    auto wait() -> void;
+
+private:
+    struct queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    // Tasks waiting in a queue, and tasks not finished yet.
+    std::atomic<std::size_t> queued{0};
+    std::atomic<std::size_t> pending{0};
+    std::atomic<std::size_t> next_queue{0};
+    bool stopping = false;
+
+    auto work(unsigned int worker) -> void;
+    auto take(unsigned int worker, std::function<void()>& task) -> bool;
+    auto run(std::function<void()>& task) -> void;
+};
+
+} // namespace monoa::support
+
+#endif // MONOA_SUPPORT_SCHEDULER_HPP
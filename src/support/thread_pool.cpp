@@ -0,0 +1,101 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <support/thread_pool.hpp>
+
+namespace monoa::support {
+
+thread_pool::thread_pool(unsigned int threads)
+{
+    if (threads == 0) {
+        threads = hardware_threads();
+    }
+    for (unsigned int worker = 0; worker + 1 < threads; worker++) {
+        this->threads.emplace_back([this, worker]() { this->work(worker); });
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto& thread : this->threads) {
+        thread.join();
+    }
+}
+
+auto thread_pool::size() const -> unsigned int
+{
+    return static_cast<unsigned int>(this->threads.size()) + 1;
+}
+
+auto thread_pool::for_each(std::size_t count, const std::function<void(unsigned int, std::size_t)>& body) -> void
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->body = &body;
+        this->count = count;
+        this->next = 0;
+        this->busy = static_cast<unsigned int>(this->threads.size());
+        this->generation++;
+    }
+    this->wake.notify_all();
+    this->run(this->size() - 1);
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->done.wait(lock, [this]() { return this->busy == 0; });
+    this->body = nullptr;
+}
+
+auto thread_pool::work(unsigned int worker) -> void
+{
+    unsigned long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wake.wait(lock, [this, seen]() { return this->stopping || this->generation != seen; });
+            if (this->stopping) {
+                return;
+            }
+            seen = this->generation;
+        }
+        this->run(worker);
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (--this->busy == 0) {
+            this->done.notify_one();
+        }
+    }
+}
+
+auto thread_pool::run(unsigned int worker) -> void
+{
+    for (auto index = this->next++; index < this->count; index = this->next++) {
+        (*this->body)(worker, index);
+    }
+}
+
+auto hardware_threads() -> unsigned int
+{
+    auto threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+} // namespace monoa::support
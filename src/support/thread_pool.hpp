@@ -0,0 +1,69 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_SUPPORT_THREAD_POOL_HPP
+#define MONOA_SUPPORT_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace monoa::support {
+
+// Fixed set of threads that run the iterations of a loop, the calling thread
+// takes part as the last worker. Iterations are handed out one at a time, so
+// uneven ones balance themselves.
+class thread_pool
+{
+public:
+    // Zero threads means one per hardware thread.
+    thread_pool(unsigned int threads = 0);
+    thread_pool(const thread_pool&) = delete;
+    auto operator=(const thread_pool&) -> thread_pool& = delete;
+    ~thread_pool();
+    // Number of workers, the calling thread included.
+    auto size() const -> unsigned int;
+    // Calls body(worker, index) for every index below count and returns once
+    // all of them are done. Worker numbers are below size().
+    auto for_each(std::size_t count, const std::function<void(unsigned int, std::size_t)>& body) -> void;
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(unsigned int, std::size_t)>* body = nullptr;
+    std::size_t count = 0;
+    std::atomic<std::size_t> next{0};
+    unsigned int busy = 0;
+    unsigned long generation = 0;
+    bool stopping = false;
+
+    auto work(unsigned int worker) -> void;
+    auto run(unsigned int worker) -> void;
+};
+
+auto hardware_threads() -> unsigned int;
+
+} // namespace monoa::support
+
+#endif // MONOA_SUPPORT_THREAD_POOL_HPP
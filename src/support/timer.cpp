@@ -0,0 +1,129 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <support/timer.hpp>
+
+namespace monoa::support {
+
+auto pass_timer::record(const char* name,
+                        const char* unit,
+                        double wall_seconds,
+                        double cpu_seconds,
+                        std::uint64_t items,
+                        std::uint64_t runs) -> void
+{
+    // A build has a dozen phases at most, a search beats hashing them.
+    for (auto& time : this->times) {
+        if (std::strcmp(time.name, name) == 0) {
+            time.wall_seconds += wall_seconds;
+            time.cpu_seconds += cpu_seconds;
+            time.items += items;
+            time.runs += runs;
+            return;
+        }
+    }
+    this->times.push_back(pass_time{name, unit, wall_seconds, cpu_seconds, items, runs});
+}
+
+auto pass_timer::merge(const pass_timer& other) -> void
+{
+    for (const auto& time : other.times) {
+        this->record(time.name, time.unit, time.wall_seconds, time.cpu_seconds, time.items, time.runs);
+    }
+}
+
+auto pass_timer::passes() const -> const std::vector<pass_time>&
+{
+    return this->times;
+}
+
+// Wall and processor time in milliseconds, throughput in millions of items
+// per second of wall time.
+auto pass_timer::table() const -> std::string
+{
+    std::string result;
+    char line[160];
+    std::snprintf(line,
+                  sizeof(line),
+                  "%-10s %12s %12s %14s %-12s %12s\n",
+                  "pass",
+                  "wall ms",
+                  "cpu ms",
+                  "items",
+                  "unit",
+                  "M items/s");
+    result += line;
+    double wall = 0;
+    double cpu = 0;
+    for (const auto& time : this->times) {
+        double rate = time.wall_seconds > 0 ? static_cast<double>(time.items) / time.wall_seconds / 1e6 : 0;
+        std::snprintf(line,
+                      sizeof(line),
+                      "%-10s %12.3f %12.3f %14llu %-12s %12.2f\n",
+                      time.name,
+                      time.wall_seconds * 1e3,
+                      time.cpu_seconds * 1e3,
+                      static_cast<unsigned long long>(time.items),
+                      time.unit,
+                      rate);
+        result += line;
+        wall += time.wall_seconds;
+        cpu += time.cpu_seconds;
+    }
+    std::snprintf(line, sizeof(line), "%-10s %12.3f %12.3f\n", "total", wall * 1e3, cpu * 1e3);
+    result += line;
+    return result;
+}
+
+// Phase and unit names are identifiers, nothing in them needs escaping.
+auto pass_timer::json() const -> std::string
+{
+    std::string result = "{\"passes\": [";
+    char entry[256];
+    for (std::size_t i = 0; i < this->times.size(); i++) {
+        const auto& time = this->times[i];
+        double rate = time.wall_seconds > 0 ? static_cast<double>(time.items) / time.wall_seconds : 0;
+        std::snprintf(entry,
+                      sizeof(entry),
+                      "%s\n  {\"name\": \"%s\", \"runs\": %llu, \"wall_seconds\": %.9f, \"cpu_seconds\": %.9f, "
+                      "\"items\": %llu, \"unit\": \"%s\", \"items_per_second\": %.1f}",
+                      i == 0 ? "" : ",",
+                      time.name,
+                      static_cast<unsigned long long>(time.runs),
+                      time.wall_seconds,
+                      time.cpu_seconds,
+                      static_cast<unsigned long long>(time.items),
+                      time.unit,
+                      rate);
+        result += entry;
+    }
+    result += "\n]}\n";
+    return result;
+}
+
+auto thread_cpu_seconds() -> double
+{
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) / 1e9;
+}
+
+} // namespace monoa::support
@@ -0,0 +1,116 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_SUPPORT_TIMER_HPP
+#define MONOA_SUPPORT_TIMER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace monoa::support {
+
+// Time and work of one phase of a build, summed over every run of it.
+struct pass_time
+{
+    const char* name;
+    // What the phase counts its work in, bytes, tokens, nodes...
+    const char* unit;
+    double wall_seconds = 0;
+    double cpu_seconds = 0;
+    std::uint64_t items = 0;
+    std::uint64_t runs = 0;
+};
+
+// Collects the phases of a build in the order they first ran. Not shared
+// between threads, a build on several inputs keeps one per input and merges
+// them once done.
+class pass_timer
+{
+public:
+    auto record(const char* name,
+                const char* unit,
+                double wall_seconds,
+                double cpu_seconds,
+                std::uint64_t items,
+                std::uint64_t runs = 1) -> void;
+    auto merge(const pass_timer& other) -> void;
+    auto passes() const -> const std::vector<pass_time>&;
+    auto table() const -> std::string;
+    auto json() const -> std::string;
+
+private:
+    std::vector<pass_time> times;
+};
+
+// Processor time of the calling thread. Work a phase hands to other threads
+// shows in its wall time only.
+auto thread_cpu_seconds() -> double;
+
+// Times the scope it lives in into a pass_timer. Without a timer it reads no
+// clock and records nothing, phases keep their timers in every build.
+class scoped_timer
+{
+public:
+    scoped_timer(pass_timer* timer, const char* name, const char* unit, std::uint64_t items = 0)
+        : timer(timer), name(name), unit(unit), items(items)
+    {
+        if (timer != nullptr) {
+            this->wall_start = std::chrono::steady_clock::now();
+            this->cpu_start = thread_cpu_seconds();
+        }
+    }
+
+    scoped_timer(const scoped_timer&) = delete;
+    auto operator=(const scoped_timer&) -> scoped_timer& = delete;
+
+    ~scoped_timer()
+    {
+        if (this->timer != nullptr) {
+            std::chrono::duration<double> wall = std::chrono::steady_clock::now() - this->wall_start;
+            auto cpu = thread_cpu_seconds() - this->cpu_start;
+            this->timer->record(this->name, this->unit, wall.count(), cpu, this->items);
+        }
+    }
+
+    // Whether anything is recorded, work counted only for the report is
+    // skipped otherwise.
+    auto active() const -> bool
+    {
+        return this->timer != nullptr;
+    }
+
+    // Work done, for phases that only know it once done.
+    auto set_items(std::uint64_t items) -> void
+    {
+        this->items = items;
+    }
+
+private:
+    pass_timer* timer;
+    const char* name;
+    const char* unit;
+    std::uint64_t items;
+    std::chrono::steady_clock::time_point wall_start;
+    double cpu_start = 0;
+};
+
+} // namespace monoa::support
+
+#endif // MONOA_SUPPORT_TIMER_HPP
@@ -0,0 +1,101 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vm/bytecode.hpp>
+
+namespace {
+
+using namespace monoa::vm;
+
+const char* opcode_names[opcode_count] = {
+    "add_u8",     "add_i8",     "add_u16",     "add_i16",     "add_u32",     "add_i32",     "add_u64", "add_i64",
+    "sub_u8",     "sub_i8",     "sub_u16",     "sub_i16",     "sub_u32",     "sub_i32",     "sub_u64", "sub_i64",
+    "mul_u8",     "mul_i8",     "mul_u16",     "mul_i16",     "mul_u32",     "mul_i32",     "mul_u64", "mul_i64",
+    "div_u8",     "div_i8",     "div_u16",     "div_i16",     "div_u32",     "div_i32",     "div_u64", "div_i64",
+    "convert_u8", "convert_i8", "convert_u16", "convert_i16", "convert_u32", "convert_i32", "ret",
+};
+
+// Position of an integer type within the opcodes of one operation.
+auto type_index(monoa::ast::basic_type type) -> std::optional<std::size_t>
+{
+    if (type < monoa::ast::basic_type::u8 || type > monoa::ast::basic_type::i64) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(type) - static_cast<std::size_t>(monoa::ast::basic_type::u8);
+}
+
+auto register_string(std::uint16_t number) -> std::string
+{
+    return "r" + std::to_string(number);
+}
+
+} // namespace
+
+namespace monoa::vm {
+
+auto typed(opcode code, ast::basic_type type) -> std::optional<opcode>
+{
+    auto index = type_index(type);
+    if (!index.has_value()) {
+        return std::nullopt;
+    }
+    return static_cast<opcode>(static_cast<std::size_t>(code) + index.value());
+}
+
+auto convert(ast::basic_type type) -> std::optional<opcode>
+{
+    auto index = type_index(type);
+    if (!index.has_value() || type == ast::basic_type::u64 || type == ast::basic_type::i64) {
+        return std::nullopt;
+    }
+    return static_cast<opcode>(static_cast<std::size_t>(opcode::convert_u8) + index.value());
+}
+
+auto opcode_name(opcode code) -> const char*
+{
+    return opcode_names[static_cast<std::size_t>(code)];
+}
+
+auto dump(const program& program) -> std::string
+{
+    std::string text;
+    for (const auto& function : program.functions) {
+        text += "function " + function.name + " ; " + std::to_string(function.register_count) + " registers\n";
+        for (std::size_t i = 0; i < function.constants.size(); i++) {
+            text += "    " + register_string(static_cast<std::uint16_t>(i)) + " = " +
+                    std::to_string(static_cast<std::int64_t>(function.constants[i])) + "\n";
+        }
+        for (const auto& instruction : function.code) {
+            text += "    ";
+            if (instruction.code == opcode::ret) {
+                text += std::string("ret ") + register_string(instruction.left) + "\n";
+                continue;
+            }
+            text += register_string(instruction.target) + " = " + opcode_name(instruction.code) + " " +
+                    register_string(instruction.left);
+            if (instruction.code < opcode::convert_u8) {
+                text += ", " + register_string(instruction.right);
+            }
+            text += "\n";
+        }
+        text += "\n";
+    }
+    return text;
+}
+
+} // namespace monoa::vm
@@ -0,0 +1,121 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_VM_BYTECODE_HPP
+#define MONOA_VM_BYTECODE_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include <ast/ast.hpp>
+
+namespace monoa::vm {
+
+// Every operation comes in one opcode per integer type, in the order of
+// ast::basic_type, so that running it never looks at a type. Results are kept
+// sign or zero extended to 64 bits like the native backend does, conversions
+// to 64 bit types are then no-ops and have no opcode.
+enum class opcode : std::uint8_t
+{
+    add_u8,
+    add_i8,
+    add_u16,
+    add_i16,
+    add_u32,
+    add_i32,
+    add_u64,
+    add_i64,
+
+    sub_u8,
+    sub_i8,
+    sub_u16,
+    sub_i16,
+    sub_u32,
+    sub_i32,
+    sub_u64,
+    sub_i64,
+
+    mul_u8,
+    mul_i8,
+    mul_u16,
+    mul_i16,
+    mul_u32,
+    mul_i32,
+    mul_u64,
+    mul_i64,
+
+    div_u8,
+    div_i8,
+    div_u16,
+    div_i16,
+    div_u32,
+    div_i32,
+    div_u64,
+    div_i64,
+
+    // Extends the low bits of left into target.
+    convert_u8,
+    convert_i8,
+    convert_u16,
+    convert_i16,
+    convert_u32,
+    convert_i32,
+
+    // Returns left.
+    ret,
+};
+
+constexpr std::size_t opcode_count = static_cast<std::size_t>(opcode::ret) + 1;
+
+// Three register numbers, what they mean is up to the opcode.
+struct instruction
+{
+    opcode code;
+    std::uint16_t target = 0;
+    std::uint16_t left = 0;
+    std::uint16_t right = 0;
+};
+
+// Registers start with the constants, in order, the rest hold the results of
+// instructions. A frame is `register_count` 64 bit registers, code always
+// ends with a ret.
+struct function
+{
+    std::string name;
+    std::vector<std::uint64_t> constants;
+    std::uint32_t register_count = 0;
+    std::vector<instruction> code;
+};
+
+struct program
+{
+    std::vector<function> functions;
+};
+
+// Opcode of an add, sub, mul or div for another type, nothing for types with
+// no integer opcode.
+auto typed(opcode code, ast::basic_type type) -> std::optional<opcode>;
+// Opcode converting to a type, nothing for the 64 bit types.
+auto convert(ast::basic_type type) -> std::optional<opcode>;
+auto opcode_name(opcode code) -> const char*;
+auto dump(const program& program) -> std::string;
+
+} // namespace monoa::vm
+
+#endif // MONOA_VM_BYTECODE_HPP
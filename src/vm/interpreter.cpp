@@ -0,0 +1,215 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <vm/interpreter.hpp>
+
+namespace monoa::vm {
+
+interpreter::interpreter(const program* program)
+{
+    for (const auto& function : program->functions) {
+        if (!this->thread(function)) {
+            this->error_string = "invalid bytecode in function '" + function.name + "'";
+            return;
+        }
+    }
+}
+
+auto interpreter::error() -> std::optional<std::string>
+{
+    return this->error_string;
+}
+
+auto interpreter::find(std::string_view name) -> std::optional<std::size_t>
+{
+    for (std::size_t i = 0; i < this->routines.size(); i++) {
+        if (this->routines[i].source->name == name) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+auto interpreter::call(std::string_view name) -> std::optional<std::int64_t>
+{
+    auto function = this->find(name);
+    if (!function.has_value()) {
+        this->error_string = "no function '" + std::string(name) + "'";
+        return std::nullopt;
+    }
+    return this->call(function.value());
+}
+
+auto interpreter::call(std::size_t function) -> std::optional<std::int64_t>
+{
+    const auto& routine = this->routines[function];
+    const auto& constants = routine.source->constants;
+    std::copy(constants.begin(), constants.end(), this->registers.begin());
+    std::uint64_t value = 0;
+    switch (execute(routine.code.data(), this->registers.data(), value, nullptr)) {
+    case outcome::division_by_zero:
+        this->error_string = "division by zero in function '" + routine.source->name + "'";
+        return std::nullopt;
+    case outcome::division_overflow:
+        this->error_string = "division overflows in function '" + routine.source->name + "'";
+        return std::nullopt;
+    case outcome::returned:
+        break;
+    }
+    return static_cast<std::int64_t>(value);
+}
+
+// Checks every register is within the frame before any of it runs, handlers
+// do not check anything.
+auto interpreter::thread(const function& function) -> bool
+{
+    if (function.code.empty() || function.code.back().code != opcode::ret ||
+        function.constants.size() > function.register_count) {
+        return false;
+    }
+    const void* const* handlers = nullptr;
+    std::uint64_t unused = 0;
+    execute(nullptr, nullptr, unused, &handlers);
+
+    auto& routine = this->routines.emplace_back();
+    routine.source = &function;
+    routine.code.reserve(function.code.size());
+    for (const auto& instruction : function.code) {
+        auto code = static_cast<std::size_t>(instruction.code);
+        if (code >= opcode_count || instruction.target >= function.register_count ||
+            instruction.left >= function.register_count || instruction.right >= function.register_count) {
+            return false;
+        }
+        routine.code.push_back(step{handlers[code], instruction.target, instruction.left, instruction.right});
+    }
+    if (this->registers.size() < function.register_count) {
+        this->registers.resize(function.register_count);
+    }
+    return true;
+}
+
+// Labels are only visible within the function defining them, so without code
+// this hands out the handler of every opcode instead.
+auto interpreter::execute(const step* code, std::uint64_t* registers, std::uint64_t& value, const void* const** handlers)
+    -> outcome
+{
+    static const void* const table[] = {
+        &&add_u8,     &&add_i8,     &&add_u16,     &&add_i16,     &&add_u32,     &&add_i32,     &&add_u64, &&add_i64,
+        &&sub_u8,     &&sub_i8,     &&sub_u16,     &&sub_i16,     &&sub_u32,     &&sub_i32,     &&sub_u64, &&sub_i64,
+        &&mul_u8,     &&mul_i8,     &&mul_u16,     &&mul_i16,     &&mul_u32,     &&mul_i32,     &&mul_u64, &&mul_i64,
+        &&div_u8,     &&div_i8,     &&div_u16,     &&div_i16,     &&div_u32,     &&div_i32,     &&div_u64, &&div_i64,
+        &&convert_u8, &&convert_i8, &&convert_u16, &&convert_i16, &&convert_u32, &&convert_i32, &&ret,
+    };
+    static_assert(std::size(table) == opcode_count, "every opcode needs a handler");
+    if (code == nullptr) {
+        *handlers = table;
+        return outcome::returned;
+    }
+
+    auto* r = registers;
+    goto* code->handler;
+
+    // Arithmetic is done on all 64 bits, then the result is extended from
+    // its type again, wrapping as the native code does.
+#define MONOA_NEXT() goto*(++code)->handler
+#define MONOA_EXTEND(type, expression) static_cast<std::uint64_t>(static_cast<type>(expression))
+#define MONOA_BINARY(name, type, operator)                                                                             \
+    name:                                                                                                              \
+    r[code->target] = MONOA_EXTEND(type, r[code->left] operator r[code->right]);                                       \
+    MONOA_NEXT();
+#define MONOA_DIVIDE_UNSIGNED(name, type)                                                                              \
+    name:                                                                                                              \
+    if (r[code->right] == 0) {                                                                                         \
+        return outcome::division_by_zero;                                                                              \
+    }                                                                                                                  \
+    r[code->target] = MONOA_EXTEND(type, r[code->left] / r[code->right]);                                              \
+    MONOA_NEXT();
+#define MONOA_DIVIDE_SIGNED(name, type)                                                                                \
+    name:                                                                                                              \
+    if (r[code->right] == 0) {                                                                                         \
+        return outcome::division_by_zero;                                                                              \
+    }                                                                                                                  \
+    if (r[code->left] == 0x8000000000000000 && r[code->right] == ~std::uint64_t{0}) {                                  \
+        return outcome::division_overflow;                                                                             \
+    }                                                                                                                  \
+    r[code->target] =                                                                                                  \
+        MONOA_EXTEND(type, static_cast<std::int64_t>(r[code->left]) / static_cast<std::int64_t>(r[code->right]));     \
+    MONOA_NEXT();
+#define MONOA_CONVERT(name, type)                                                                                      \
+    name:                                                                                                              \
+    r[code->target] = MONOA_EXTEND(type, r[code->left]);                                                               \
+    MONOA_NEXT();
+
+    MONOA_BINARY(add_u8, std::uint8_t, +)
+    MONOA_BINARY(add_i8, std::int8_t, +)
+    MONOA_BINARY(add_u16, std::uint16_t, +)
+    MONOA_BINARY(add_i16, std::int16_t, +)
+    MONOA_BINARY(add_u32, std::uint32_t, +)
+    MONOA_BINARY(add_i32, std::int32_t, +)
+    MONOA_BINARY(add_u64, std::uint64_t, +)
+    MONOA_BINARY(add_i64, std::uint64_t, +)
+
+    MONOA_BINARY(sub_u8, std::uint8_t, -)
+    MONOA_BINARY(sub_i8, std::int8_t, -)
+    MONOA_BINARY(sub_u16, std::uint16_t, -)
+    MONOA_BINARY(sub_i16, std::int16_t, -)
+    MONOA_BINARY(sub_u32, std::uint32_t, -)
+    MONOA_BINARY(sub_i32, std::int32_t, -)
+    MONOA_BINARY(sub_u64, std::uint64_t, -)
+    MONOA_BINARY(sub_i64, std::uint64_t, -)
+
+    MONOA_BINARY(mul_u8, std::uint8_t, *)
+    MONOA_BINARY(mul_i8, std::int8_t, *)
+    MONOA_BINARY(mul_u16, std::uint16_t, *)
+    MONOA_BINARY(mul_i16, std::int16_t, *)
+    MONOA_BINARY(mul_u32, std::uint32_t, *)
+    MONOA_BINARY(mul_i32, std::int32_t, *)
+    MONOA_BINARY(mul_u64, std::uint64_t, *)
+    MONOA_BINARY(mul_i64, std::uint64_t, *)
+
+    MONOA_DIVIDE_UNSIGNED(div_u8, std::uint8_t)
+    MONOA_DIVIDE_SIGNED(div_i8, std::int8_t)
+    MONOA_DIVIDE_UNSIGNED(div_u16, std::uint16_t)
+    MONOA_DIVIDE_SIGNED(div_i16, std::int16_t)
+    MONOA_DIVIDE_UNSIGNED(div_u32, std::uint32_t)
+    MONOA_DIVIDE_SIGNED(div_i32, std::int32_t)
+    MONOA_DIVIDE_UNSIGNED(div_u64, std::uint64_t)
+    MONOA_DIVIDE_SIGNED(div_i64, std::int64_t)
+
+    MONOA_CONVERT(convert_u8, std::uint8_t)
+    MONOA_CONVERT(convert_i8, std::int8_t)
+    MONOA_CONVERT(convert_u16, std::uint16_t)
+    MONOA_CONVERT(convert_i16, std::int16_t)
+    MONOA_CONVERT(convert_u32, std::uint32_t)
+    MONOA_CONVERT(convert_i32, std::int32_t)
+
+#undef MONOA_NEXT
+#undef MONOA_EXTEND
+#undef MONOA_BINARY
+#undef MONOA_DIVIDE_UNSIGNED
+#undef MONOA_DIVIDE_SIGNED
+#undef MONOA_CONVERT
+
+ret:
+    value = r[code->left];
+    return outcome::returned;
+}
+
+} // namespace monoa::vm
@@ -0,0 +1,80 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_VM_INTERPRETER_HPP
+#define MONOA_VM_INTERPRETER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vm/bytecode.hpp>
+
+namespace monoa::vm {
+
+// Runs bytecode with direct threaded dispatch. The code of every function is
+// translated once into the address of the handler of each instruction, and
+// every handler jumps straight to the handler of the next one.
+class interpreter
+{
+public:
+    interpreter(const program* program);
+    auto error() -> std::optional<std::string>;
+    // Index of a function in the program.
+    auto find(std::string_view name) -> std::optional<std::size_t>;
+    // Calls a function taking no arguments, nothing when it does not exist
+    // or stops on an error.
+    auto call(std::string_view name) -> std::optional<std::int64_t>;
+    auto call(std::size_t function) -> std::optional<std::int64_t>;
+
+private:
+    struct step
+    {
+        const void* handler;
+        std::uint16_t target;
+        std::uint16_t left;
+        std::uint16_t right;
+    };
+
+    struct routine
+    {
+        const function* source;
+        std::vector<step> code;
+    };
+
+    enum class outcome
+    {
+        returned,
+        division_by_zero,
+        division_overflow,
+    };
+
+    std::optional<std::string> error_string;
+    std::vector<routine> routines;
+    std::vector<std::uint64_t> registers;
+
+    auto thread(const function& function) -> bool;
+    static auto execute(const step* code, std::uint64_t* registers, std::uint64_t& value, const void* const** handlers)
+        -> outcome;
+};
+
+} // namespace monoa::vm
+
+#endif // MONOA_VM_INTERPRETER_HPP
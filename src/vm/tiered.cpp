@@ -0,0 +1,190 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <backend/encoder.hpp>
+#include <backend/x86.hpp>
+#include <vm/tiered.hpp>
+
+namespace {
+
+using namespace monoa;
+
+auto extend(std::uint64_t bits, ast::basic_type type) -> ir::operand
+{
+    switch (type) {
+    case ast::basic_type::u8:
+        return ir::operand::constant(static_cast<std::uint8_t>(bits));
+    case ast::basic_type::i8:
+        return ir::operand::constant(static_cast<std::uint64_t>(static_cast<std::int8_t>(bits)));
+    case ast::basic_type::u16:
+        return ir::operand::constant(static_cast<std::uint16_t>(bits));
+    case ast::basic_type::i16:
+        return ir::operand::constant(static_cast<std::uint64_t>(static_cast<std::int16_t>(bits)));
+    case ast::basic_type::u32:
+        return ir::operand::constant(static_cast<std::uint32_t>(bits));
+    case ast::basic_type::i32:
+        return ir::operand::constant(static_cast<std::uint64_t>(static_cast<std::int32_t>(bits)));
+    default:
+        return ir::operand::constant(bits);
+    }
+}
+
+} // namespace
+
+namespace monoa::vm {
+
+tiered::tiered(const program* program, tier_options options)
+    : source(program), settings(options), cold(program), entries(program->functions.size())
+{
+    this->error_string = this->cold.error();
+}
+
+auto tiered::error() -> std::optional<std::string>
+{
+    return this->error_string;
+}
+
+auto tiered::find(std::string_view name) -> std::optional<std::size_t>
+{
+    return this->cold.find(name);
+}
+
+auto tiered::call(std::string_view name) -> std::optional<std::int64_t>
+{
+    auto function = this->find(name);
+    if (!function.has_value()) {
+        this->error_string = "no function '" + std::string(name) + "'";
+        return std::nullopt;
+    }
+    return this->call(function.value());
+}
+
+auto tiered::call(std::size_t function) -> std::optional<std::int64_t>
+{
+    auto& entry = this->entries[function];
+    if (entry.native != nullptr || (++entry.calls > this->settings.threshold && this->promote(function))) {
+        auto result = entry.native();
+        if (static_cast<backend::division_status>(result.status) == backend::division_status::defined) {
+            return result.value;
+        }
+        return this->run_cold(function);
+    }
+    return this->run_cold(function);
+}
+
+auto tiered::tier_ups() -> const std::vector<tier_up>&
+{
+    return this->promoted;
+}
+
+auto tiered::run_cold(std::size_t function) -> std::optional<std::int64_t>
+{
+    auto result = this->cold.call(function);
+    if (!result.has_value()) {
+        this->error_string = this->cold.error();
+    }
+    return result;
+}
+
+// A function that fails to compile keeps running on the interpreter, and so
+// does one too large to be compiled.
+auto tiered::promote(std::size_t function) -> bool
+{
+    auto start = std::chrono::steady_clock::now();
+    auto& entry = this->entries[function];
+    const auto& bytecode = this->source->functions[function];
+    if (bytecode.code.size() > this->settings.max_size) {
+        entry.calls = 0;
+        return false;
+    }
+    auto lowered = lower(bytecode);
+    if (ir::verify(lowered).has_value()) {
+        entry.calls = 0;
+        return false;
+    }
+
+    backend::function_emitter emitter(backend::options{this->settings.peephole, 1, nullptr, true});
+    emitter.emit(lowered, 0);
+    backend::assembly program;
+    backend::append_function(backend::emitted_function{{bytecode.name}, emitter.records(), {}}, program);
+    backend::encoder encoder(&program);
+    if (encoder.error().has_value()) {
+        entry.calls = 0;
+        return false;
+    }
+    entry.code = std::make_unique<backend::jit>(encoder.text(), &encoder.symbols());
+    entry.native = entry.code->entry(bytecode.name);
+    if (entry.code->error().has_value() || entry.native == nullptr) {
+        entry.code.reset();
+        entry.native = nullptr;
+        entry.calls = 0;
+        return false;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    this->promoted.push_back(tier_up{bytecode.name, entry.calls, elapsed.count()});
+    return true;
+}
+
+// Registers are written again once their temporary is free, every write is a
+// new value. The bytecode has no conversions to 64 bit types, they are put
+// back where a value is used with another type. Code following a ret goes
+// into a block nothing jumps to.
+auto lower(const function& function) -> ir::function
+{
+    ir::function lowered;
+    lowered.name = function.name;
+    ir::builder builder(&lowered);
+
+    std::vector<ir::operand> registers(function.register_count, ir::operand::constant(0));
+    for (std::size_t i = 0; i < function.constants.size(); i++) {
+        registers[i] = ir::operand::constant(function.constants[i]);
+    }
+    auto use = [&builder, &lowered, &registers](std::uint16_t number, ast::basic_type type) {
+        auto value = registers[number];
+        if (value.is_value() && lowered.value_types[value.id()] != type) {
+            value = builder.convert(type, value);
+        }
+        return value;
+    };
+
+    for (const auto& instruction : function.code) {
+        if (builder.is_terminated()) {
+            builder.set_block(builder.create_block());
+        }
+        auto code = static_cast<std::size_t>(instruction.code);
+        if (instruction.code == opcode::ret) {
+            builder.ret(registers[instruction.left]);
+        } else if (instruction.code >= opcode::convert_u8) {
+            auto type = static_cast<ast::basic_type>(static_cast<std::size_t>(ast::basic_type::u8) + code -
+                                                     static_cast<std::size_t>(opcode::convert_u8));
+            auto left = registers[instruction.left];
+            registers[instruction.target] = left.is_value() ? builder.convert(type, left) : extend(left.data, type);
+        } else {
+            ir::opcode operations[] = {ir::opcode::add, ir::opcode::sub, ir::opcode::mul, ir::opcode::div};
+            auto type = static_cast<ast::basic_type>(static_cast<std::size_t>(ast::basic_type::u8) + code % 8);
+            auto left = use(instruction.left, type);
+            auto right = use(instruction.right, type);
+            registers[instruction.target] = builder.binary(operations[code / 8], type, left, right);
+        }
+    }
+    return lowered;
+}
+
+} // namespace monoa::vm
@@ -0,0 +1,96 @@
+/*
+ * This file is part of Monoa
+ * Copyright (c) 2020 Nattakit Hosapsin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONOA_VM_TIERED_HPP
+#define MONOA_VM_TIERED_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <backend/jit.hpp>
+#include <ir/ir.hpp>
+#include <vm/bytecode.hpp>
+#include <vm/interpreter.hpp>
+
+namespace monoa::vm {
+
+struct tier_options
+{
+    // Calls run on the interpreter before a function is compiled, zero
+    // compiles every function on its first call.
+    std::uint32_t threshold = 64;
+    // Functions with more bytecode instructions stay on the interpreter,
+    // compiling them would stall the call that crosses the threshold.
+    std::size_t max_size = 8192;
+    bool peephole = true;
+};
+
+// A function promoted to native code, in the order it happened.
+struct tier_up
+{
+    std::string function;
+    std::uint64_t calls;
+    double compile_seconds;
+};
+
+// Starts every function on the interpreter and counts its calls. Past the
+// threshold the function's bytecode is compiled on its own into machine code,
+// and its entry in the function table is patched so that later calls go
+// straight to it. Native code is emitted with checked division, a call whose
+// division fails is run again on the interpreter, which reports the error:
+// which tier a call runs in is never observable. Functions take no arguments
+// and have no effects, so running them again is safe.
+class tiered
+{
+public:
+    tiered(const program* program, tier_options options = {});
+    auto error() -> std::optional<std::string>;
+    auto find(std::string_view name) -> std::optional<std::size_t>;
+    auto call(std::string_view name) -> std::optional<std::int64_t>;
+    auto call(std::size_t function) -> std::optional<std::int64_t>;
+    auto tier_ups() -> const std::vector<tier_up>&;
+
+private:
+    struct entry
+    {
+        backend::native_function native = nullptr;
+        std::uint64_t calls = 0;
+        std::unique_ptr<backend::jit> code;
+    };
+
+    std::optional<std::string> error_string;
+    const program* source;
+    tier_options settings;
+    interpreter cold;
+    std::vector<entry> entries;
+    std::vector<tier_up> promoted;
+
+    auto promote(std::size_t function) -> bool;
+    auto run_cold(std::size_t function) -> std::optional<std::int64_t>;
+};
+
+// Rewrites the bytecode of a function as IR, for the native backend.
+auto lower(const function& function) -> ir::function;
+
+} // namespace monoa::vm
+
+#endif // MONOA_VM_TIERED_HPP